@@ -1,11 +1,13 @@
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <chrono>
 #include <regex>
 #include <numeric>
 #include <map>
+#include <algorithm>
 #include <tuple>
 #include <boost/regex.hpp>
 #define PCRE2_CODE_UNIT_WIDTH 8
@@ -13,6 +15,50 @@
 #include <re2/re2.h>
 #include <iomanip>
 #include <unordered_set>
+#include <unordered_map>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <limits>
+#include <type_traits>
+#include <cstdint>
+#include <climits>
+#include <cctype>
+#include <new>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#include <malloc.h>
+#elif defined(__linux__)
+#include <unistd.h>
+#include <malloc.h>
+#include <sched.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <csignal>
+#endif
+#ifdef REGEX_BENCH_WITH_ZLIB
+#include <zlib.h>
+#endif
+#ifdef REGEX_BENCH_WITH_ZSTD
+#include <zstd.h>
+#endif
+#ifdef REGEX_BENCH_WITH_LZ4
+#include <lz4frame.h>
+#endif
 
 using namespace std;
 using namespace std::chrono;
@@ -57,6 +103,15 @@ const vector<pair<string, string>> war_and_peace_russian_patterns = {
     {"Французские фразы", R"(\b[А-Яа-я]+\s[А-Яа-я]+\s[А-Яа-я]+\b)"}
 };
 
+// Шаблоны для проверки глобального обхода: пустые совпадения и контекст перед позицией старта.
+// RE2 работает в UTF-8 и после пустого совпадения сдвигается на символ, а не на байт,
+// поэтому на не-ASCII тексте для \w* он находит немного меньше пустых совпадений
+const vector<pair<string, string>> iteration_check_patterns = {
+    {"Empty-capable words", R"(\w*)"},
+    {"Word boundaries", R"(\b)"},
+    {"Word starts", R"(\b\w)"},
+    {"Capitalized after comma", R"((?<=, )[A-Z]\w+)"}
+};
 
 struct TestResult {
     string operation;
@@ -68,6 +123,72 @@ struct TestResult {
 
 vector<TestResult> all_results;
 
+// Учет выделений памяти через operator new/delete. Счетчики thread_local, чтобы многопоточные тесты
+// не конкурировали за одну кэш-линию, и включаются только внутри AllocationScope: вне окон замера
+// (во всех сравнительных тестах) замененный operator new стоит одной проверки флага поверх malloc.
+// Учитываются выделения и освобождения потока, открывшего окно; память, выделенную до окна
+// и освобожденную внутри него, окно видит как уменьшение live_bytes
+struct AllocationCounters {
+    long long live_bytes = 0;
+    long long allocated_bytes = 0;
+    size_t allocations = 0;
+    bool enabled = false;
+};
+
+thread_local AllocationCounters allocation_counters;
+
+class AllocationScope {
+public:
+    AllocationScope() : previous_(allocation_counters.enabled) { allocation_counters.enabled = true; }
+    ~AllocationScope() { allocation_counters.enabled = previous_; }
+
+    AllocationScope(const AllocationScope&) = delete;
+    AllocationScope& operator=(const AllocationScope&) = delete;
+
+private:
+    bool previous_;
+};
+
+size_t allocated_size(void* ptr) {
+#if defined(_WIN32)
+    return _msize(ptr);
+#elif defined(__linux__)
+    return malloc_usable_size(ptr);
+#else
+    (void)ptr;
+    return 0;
+#endif
+}
+
+void* operator new(size_t size) {
+    void* ptr = malloc(size ? size : 1);
+    if (!ptr) throw bad_alloc();
+    if (allocation_counters.enabled) {
+        allocation_counters.allocations++;
+        allocation_counters.allocated_bytes += allocated_size(ptr);
+        allocation_counters.live_bytes += allocated_size(ptr);
+    }
+    return ptr;
+}
+
+// operator new выше тоже выделяет через malloc, поэтому предупреждение GCC о free здесь ложное
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void operator delete(void* ptr) noexcept {
+    if (!ptr) return;
+    if (allocation_counters.enabled) allocation_counters.live_bytes -= allocated_size(ptr);
+    free(ptr);
+}
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic pop
+#endif
+
+void operator delete(void* ptr, size_t) noexcept {
+    operator delete(ptr);
+}
+
 void warmup_cache(const vector<string>& words) {
     volatile size_t dummy = 0;
     for (const auto& word : words) {
@@ -79,19 +200,705 @@ void warmup_cache(const vector<string>& words) {
     (void)dummy;
 }
 
+// Поток байт набора данных: обычный файл или сжатый (.gz, .zst, .lz4) с потоковой распаковкой.
+// Поддержка форматов включается при сборке макросами REGEX_BENCH_WITH_ZLIB/ZSTD/LZ4
+class DatasetReader {
+public:
+    enum class Format { Plain, Gzip, Zstd, Lz4 };
+
+    explicit DatasetReader(const string& filename) : filename_(filename), format_(detect_format(filename)) {
+        switch (format_) {
+            case Format::Plain:
+                file_.open(filename, ios::binary);
+                ok_ = static_cast<bool>(file_);
+                break;
+            case Format::Gzip:
+#ifdef REGEX_BENCH_WITH_ZLIB
+                file_.open(filename, ios::binary);
+                // 16 + MAX_WBITS - разбор заголовка gzip
+                zlib_ready_ = inflateInit2(&zlib_, 16 + MAX_WBITS) == Z_OK;
+                input_.resize(1 << 17);
+                ok_ = file_ && zlib_ready_;
+#endif
+                break;
+            case Format::Zstd:
+#ifdef REGEX_BENCH_WITH_ZSTD
+                file_.open(filename, ios::binary);
+                zstd_ = ZSTD_createDStream();
+                ZSTD_initDStream(zstd_);
+                input_.resize(ZSTD_DStreamInSize());
+                ok_ = file_ && zstd_;
+#endif
+                break;
+            case Format::Lz4:
+#ifdef REGEX_BENCH_WITH_LZ4
+                file_.open(filename, ios::binary);
+                ok_ = file_ && !LZ4F_isError(LZ4F_createDecompressionContext(&lz4_, LZ4F_VERSION));
+                input_.resize(1 << 16);
+#endif
+                break;
+        }
+        if (!ok_) {
+            cerr << "Cannot open " << filename << " (" << format_name() << " support: "
+                 << (format_supported(format_) ? "yes" : "not compiled in") << ")" << endl;
+        }
+    }
+
+    DatasetReader(const DatasetReader&) = delete;
+    DatasetReader& operator=(const DatasetReader&) = delete;
+
+    ~DatasetReader() {
+#ifdef REGEX_BENCH_WITH_ZLIB
+        if (zlib_ready_) inflateEnd(&zlib_);
+#endif
+#ifdef REGEX_BENCH_WITH_ZSTD
+        if (zstd_) ZSTD_freeDStream(zstd_);
+#endif
+#ifdef REGEX_BENCH_WITH_LZ4
+        if (lz4_) LZ4F_freeDecompressionContext(lz4_);
+#endif
+    }
+
+    bool ok() const { return ok_; }
+
+    // Ошибка декодера или поток, оборванный до конца кадра; то, что успело распаковаться, неполно
+    bool failed() const { return failed_; }
+
+    const char* format_name() const {
+        switch (format_) {
+            case Format::Plain: return "plain";
+            case Format::Gzip: return "gzip";
+            case Format::Zstd: return "zstd";
+            case Format::Lz4: return "lz4";
+        }
+        return "";
+    }
+
+    // Сжатых байт прочитано с диска (для обычного файла совпадает с распакованными)
+    size_t compressed_bytes() const { return compressed_bytes_; }
+
+    // Время внутри вызовов распаковки (inflate, ZSTD_decompressStream, LZ4F_decompress) без чтения файла
+    // и копирования буферов; для обычного файла 0
+    long long decode_ns() const { return decode_ns_; }
+
+    // Заполняет буфер целиком; меньше size байт возвращается только в конце потока или при ошибке (см. failed())
+    size_t read(char* buffer, size_t size) {
+        if (!ok_) return 0;
+        switch (format_) {
+            case Format::Plain: {
+                file_.read(buffer, size);
+                size_t got = file_.gcount();
+                compressed_bytes_ += got;
+                return got;
+            }
+            case Format::Gzip:
+                return read_gzip(buffer, size);
+            case Format::Zstd:
+                return read_zstd(buffer, size);
+            case Format::Lz4:
+                return read_lz4(buffer, size);
+        }
+        return 0;
+    }
+
+    static Format detect_format(const string& filename) {
+        auto ends_with = [&](const string& suffix) {
+            return filename.size() >= suffix.size() &&
+                   filename.compare(filename.size() - suffix.size(), suffix.size(), suffix) == 0;
+        };
+        if (ends_with(".gz")) return Format::Gzip;
+        if (ends_with(".zst")) return Format::Zstd;
+        if (ends_with(".lz4")) return Format::Lz4;
+        return Format::Plain;
+    }
+
+    static bool format_supported(Format format) {
+        switch (format) {
+            case Format::Plain: return true;
+#ifdef REGEX_BENCH_WITH_ZLIB
+            case Format::Gzip: return true;
+#endif
+#ifdef REGEX_BENCH_WITH_ZSTD
+            case Format::Zstd: return true;
+#endif
+#ifdef REGEX_BENCH_WITH_LZ4
+            case Format::Lz4: return true;
+#endif
+            default: return false;
+        }
+    }
+
+private:
+    void fail(const string& message) {
+        cerr << format_name() << " error in " << filename_ << ": " << message << endl;
+        failed_ = true;
+    }
+
+    // Дочитывает сжатые данные, когда входной буфер исчерпан
+    bool refill_input() {
+        if (input_pos_ < input_size_) return true;
+        if (input_eof_) return false;
+        file_.read(input_.data(), input_.size());
+        input_size_ = file_.gcount();
+        input_pos_ = 0;
+        compressed_bytes_ += input_size_;
+        input_eof_ = input_size_ == 0;
+        return !input_eof_;
+    }
+
+    size_t read_gzip(char* buffer, size_t size) {
+#ifdef REGEX_BENCH_WITH_ZLIB
+        size_t produced = 0;
+        while (produced < size && !failed_) {
+            bool have_input = refill_input();
+            uInt chunk = static_cast<uInt>(min<size_t>(size - produced, 1u << 30));
+            zlib_.next_in = reinterpret_cast<Bytef*>(input_.data() + input_pos_);
+            zlib_.avail_in = static_cast<uInt>(input_size_ - input_pos_);
+            zlib_.next_out = reinterpret_cast<Bytef*>(buffer + produced);
+            zlib_.avail_out = chunk;
+            auto decode_start = steady_clock::now();
+            int ret = inflate(&zlib_, Z_NO_FLUSH);
+            decode_ns_ += duration_cast<nanoseconds>(steady_clock::now() - decode_start).count();
+            bool consumed = input_size_ - input_pos_ != zlib_.avail_in;
+            input_pos_ = input_size_ - zlib_.avail_in;
+            size_t got = chunk - zlib_.avail_out;
+            produced += got;
+            if (ret == Z_STREAM_END) {
+                // Файл может состоять из нескольких gzip-потоков подряд
+                inflateReset(&zlib_);
+                stream_finished_ = true;
+            } else if (ret != Z_OK && ret != Z_BUF_ERROR) {
+                fail(zlib_.msg ? zlib_.msg : "inflate failed");
+            } else if (consumed || got > 0) {
+                stream_finished_ = false;
+            }
+            if (!have_input && got == 0) {
+                if (!stream_finished_) fail("stream is truncated");
+                break;
+            }
+        }
+        return produced;
+#else
+        (void)buffer; (void)size;
+        return 0;
+#endif
+    }
+
+    size_t read_zstd(char* buffer, size_t size) {
+#ifdef REGEX_BENCH_WITH_ZSTD
+        ZSTD_outBuffer output{buffer, size, 0};
+        while (output.pos < output.size && !failed_) {
+            bool have_input = refill_input();
+            ZSTD_inBuffer input{input_.data(), input_size_, input_pos_};
+            size_t before = output.pos;
+            auto decode_start = steady_clock::now();
+            size_t ret = ZSTD_decompressStream(zstd_, &output, &input);
+            decode_ns_ += duration_cast<nanoseconds>(steady_clock::now() - decode_start).count();
+            bool consumed = input.pos != input_pos_;
+            input_pos_ = input.pos;
+            if (ZSTD_isError(ret)) {
+                fail(ZSTD_getErrorName(ret));
+                break;
+            }
+            // 0 - кадр декодирован и сброшен целиком, иначе декодер ждет продолжения. Вызов без входа и выхода
+            // после конца кадра уже просит заголовок следующего, поэтому он состояние не меняет
+            if (consumed || output.pos != before) stream_finished_ = ret == 0;
+            // Вход закончился, а декодер больше ничего не отдает - конец потока
+            if (!have_input && output.pos == before) {
+                if (!stream_finished_) fail("stream is truncated");
+                break;
+            }
+        }
+        return output.pos;
+#else
+        (void)buffer; (void)size;
+        return 0;
+#endif
+    }
+
+    size_t read_lz4(char* buffer, size_t size) {
+#ifdef REGEX_BENCH_WITH_LZ4
+        size_t produced = 0;
+        while (produced < size && !failed_) {
+            bool have_input = refill_input();
+            size_t dst_size = size - produced;
+            size_t src_size = input_size_ - input_pos_;
+            auto decode_start = steady_clock::now();
+            size_t ret = LZ4F_decompress(lz4_, buffer + produced, &dst_size,
+                                         input_.data() + input_pos_, &src_size, nullptr);
+            decode_ns_ += duration_cast<nanoseconds>(steady_clock::now() - decode_start).count();
+            if (LZ4F_isError(ret)) {
+                fail(LZ4F_getErrorName(ret));
+                break;
+            }
+            // Как и у zstd, 0 означает законченный кадр, а пустой вызов после него состояние не меняет
+            if (src_size > 0 || dst_size > 0) stream_finished_ = ret == 0;
+            input_pos_ += src_size;
+            produced += dst_size;
+            if (!have_input && dst_size == 0) {
+                if (!stream_finished_) fail("stream is truncated");
+                break;
+            }
+        }
+        return produced;
+#else
+        (void)buffer; (void)size;
+        return 0;
+#endif
+    }
+
+    string filename_;
+    Format format_;
+    bool ok_ = false;
+    bool failed_ = false;
+    // Последний кадр сжатого потока дочитан до конца; пустой файл целым потоком не считается
+    bool stream_finished_ = false;
+    ifstream file_;
+    vector<char> input_;
+    size_t input_size_ = 0;
+    size_t input_pos_ = 0;
+    bool input_eof_ = false;
+    size_t compressed_bytes_ = 0;
+    long long decode_ns_ = 0;
+#ifdef REGEX_BENCH_WITH_ZLIB
+    z_stream zlib_{};
+    bool zlib_ready_ = false;
+#endif
+#ifdef REGEX_BENCH_WITH_ZSTD
+    ZSTD_DStream* zstd_ = nullptr;
+#endif
+#ifdef REGEX_BENCH_WITH_LZ4
+    LZ4F_dctx* lz4_ = nullptr;
+#endif
+};
+
+// Первый существующий вариант файла: без сжатия или с поддерживаемым расширением сжатия
+string find_dataset_file(const string& filename) {
+    for (const char* suffix : {"", ".zst", ".lz4", ".gz"}) {
+        string candidate = filename + suffix;
+        if (DatasetReader::format_supported(DatasetReader::detect_format(candidate)) && ifstream(candidate)) {
+            return candidate;
+        }
+    }
+    return "";
+}
+
+// Части наборов данных: match_1.txt, match_2.txt, ...; если частей нет, используется целый файл.
+// Каждая часть может быть сжата (match_1.txt.zst и т.п.)
+vector<string> find_dataset_parts(const string& filename) {
+    size_t dot = filename.rfind('.');
+    string stem = dot == string::npos ? filename : filename.substr(0, dot);
+    string ext = dot == string::npos ? "" : filename.substr(dot);
+
+    vector<string> parts;
+    for (int n = 1;; ++n) {
+        string part = find_dataset_file(stem + "_" + to_string(n) + ext);
+        if (part.empty()) break;
+        parts.push_back(part);
+    }
+    if (parts.empty()) {
+        string whole = find_dataset_file(filename);
+        if (!whole.empty()) parts.push_back(whole);
+    }
+    return parts;
+}
+
+// Читает поток блоками примерно по block_size байт; каждый блок заканчивается на границе строки.
+// Если on_block возвращает bool, false прекращает чтение
+template <typename OnBlock>
+void read_line_blocks(DatasetReader& reader, size_t block_size, OnBlock&& on_block) {
+    auto deliver = [&](string&& block) {
+        if constexpr (is_same_v<invoke_result_t<OnBlock&, string&&>, bool>) {
+            return on_block(move(block));
+        } else {
+            on_block(move(block));
+            return true;
+        }
+    };
+    string carry;
+    for (;;) {
+        string block = move(carry);
+        carry.clear();
+        size_t filled = block.size();
+        block.resize(filled + block_size);
+        size_t got = reader.read(&block[filled], block_size);
+        block.resize(filled + got);
+
+        if (got < block_size) {
+            if (!block.empty()) deliver(move(block));
+            break;
+        }
+
+        size_t last_newline = block.rfind('\n');
+        if (last_newline == string::npos) {
+            carry = move(block);
+            continue;
+        }
+        carry.assign(block, last_newline + 1, string::npos);
+        block.resize(last_newline + 1);
+        if (!deliver(move(block))) break;
+    }
+}
+
+// false, если файл не открылся или поток оказался оборван либо поврежден
+template <typename OnBlock>
+bool read_line_blocks(const string& filename, size_t block_size, OnBlock&& on_block) {
+    DatasetReader reader(filename);
+    if (!reader.ok()) return false;
+    read_line_blocks(reader, block_size, on_block);
+    return !reader.failed();
+}
+
+// Распаковывает часть целиком, чтобы до замеров убедиться, что она читается до конца
+bool dataset_part_intact(const string& part) {
+    DatasetReader reader(part);
+    if (!reader.ok()) return false;
+    char buffer[1 << 16];
+    while (reader.read(buffer, sizeof(buffer)) == sizeof(buffer)) {}
+    return !reader.failed();
+}
+
+// Загружает строки набора данных (все части, с распаковкой при необходимости), но не больше max_lines.
+// Если хотя бы одна часть не читается до конца, возвращается пустой список: неполные данные не замеряются
+vector<string> read_dataset_lines(const string& filename, size_t max_lines = numeric_limits<size_t>::max()) {
+    vector<string> lines;
+    for (const auto& part : find_dataset_parts(filename)) {
+        if (lines.size() >= max_lines) break;
+        bool intact = read_line_blocks(part, 1 << 20, [&](string&& block) {
+            size_t pos = 0;
+            while (pos < block.size() && lines.size() < max_lines) {
+                size_t newline = block.find('\n', pos);
+                if (newline == string::npos) newline = block.size();
+                size_t end = newline;
+                if (end > pos && block[end - 1] == '\r') end--;
+                lines.emplace_back(block, pos, end - pos);
+                pos = newline + 1;
+            }
+            return lines.size() < max_lines;
+        });
+        if (!intact) {
+            cerr << "Skipping " << filename << ": part " << part << " is unreadable, truncated or corrupt\n";
+            return {};
+        }
+    }
+    return lines;
+}
+
 string read_file_to_string(const string& filename) {
-    ifstream file(filename);
-    if (!file) {
-        cerr << "Cannot open " << filename << endl;
+    string path = find_dataset_file(filename);
+    DatasetReader reader(path.empty() ? filename : path);
+    if (!reader.ok()) {
         return "";
     }
     
-    string content((istreambuf_iterator<char>(file)), 
-                   istreambuf_iterator<char>());
-    file.close();
+    string content;
+    char buffer[1 << 16];
+    for (size_t got; (got = reader.read(buffer, sizeof(buffer))) > 0;) {
+        content.append(buffer, got);
+    }
+    if (reader.failed()) return "";
+    return content;
+}
+
+// Весь набор данных одной строкой: части (match_1.txt, match_2.txt, ...) склеиваются по порядку
+string read_dataset_text(const string& filename) {
+    string content;
+    for (const auto& part : find_dataset_parts(filename)) {
+        string text = read_file_to_string(part);
+        if (text.empty()) {
+            cerr << "Skipping " << filename << ": part " << part << " is empty, truncated or corrupt\n";
+            return "";
+        }
+        if (!content.empty() && content.back() != '\n') content += '\n';
+        content += text;
+    }
     return content;
 }
 
+// Есть ли в тексте кириллица в UTF-8 (ведущий байт 0xD0/0xD1 и байт продолжения)
+bool contains_utf8_cyrillic(string_view text) {
+    for (size_t i = 0; i + 1 < text.size(); ++i) {
+        unsigned char lead = text[i], next = text[i + 1];
+        if ((lead == 0xD0 || lead == 0xD1) && (next & 0xC0) == 0x80) return true;
+    }
+    return false;
+}
+
+// Детерминированный генератор наборов данных.
+// Собственный ГПСЧ (splitmix64) вместо распределений <random>: их результат зависит от реализации
+// стандартной библиотеки, а данные должны совпадать байт в байт на любой платформе
+struct DatasetRng {
+    uint64_t state;
+
+    uint64_t next() {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    size_t below(size_t bound) { return static_cast<size_t>(next() % bound); }
+    size_t between(size_t low, size_t high) { return low + below(high - low + 1); }
+    bool chance(unsigned percent) { return below(100) < percent; }
+
+    template <typename T>
+    const T& pick(const vector<T>& items) { return items[below(items.size())]; }
+};
+
+enum class DatasetShape { Words, FormatPaths, SearchPaths, Prose };
+
+const vector<pair<string, DatasetShape>> dataset_shapes = {
+    {"words", DatasetShape::Words},
+    {"paths", DatasetShape::FormatPaths},
+    {"search-paths", DatasetShape::SearchPaths},
+    {"prose", DatasetShape::Prose}
+};
+
+const vector<string> generated_extensions = {".exe", ".txt", ".xsls", ".jpg", ".jpeg", ".py", ".cpp", ".bin"};
+
+// Словарь для прозы: общие слова и слова, на которые рассчитаны шаблоны поиска по "Войне и миру"
+const vector<string> prose_common_words = {
+    "the", "and", "to", "of", "a", "he", "in", "his", "that", "was", "with", "had", "it", "her", "at",
+    "not", "him", "she", "said", "as", "you", "for", "on", "all", "but", "be", "is", "by", "which",
+    "they", "from", "so", "were", "what", "who", "an", "this", "one", "been", "would", "them", "now",
+    "there", "when", "or", "only", "did", "into", "could", "about", "more", "very", "face", "eyes",
+    "room", "went", "looked", "began", "thought", "without", "again", "still", "smile", "hand"
+};
+const vector<string> prose_names = {
+    "Rostov", "Bolkonsky", "Kutuzov", "Denisov", "Dolokhov", "Kuragin", "Natasha", "Pierre", "Andrew",
+    "Mary", "Sonya", "Nicholas", "Helene", "Anatole", "Bagration", "Napoleon", "Karataev", "Drubetskaya"
+};
+const vector<string> prose_theme_words = {
+    "regiment", "battalion", "cavalry", "infantry", "artillery", "sunset", "moonlight", "snow", "forest",
+    "river", "fields", "sighed", "wept", "laughed", "exclaimed", "whispered", "life", "death", "love",
+    "war", "peace", "destiny"
+};
+const vector<string> prose_titles = {"Prince", "Count", "Countess", "Baron", "Duchess"};
+const vector<string> prose_sentence_endings = {".", ".", ".", "!", "?"};
+
+string random_letters(DatasetRng& rng, size_t length, const char* alphabet, size_t alphabet_size) {
+    string result(length, ' ');
+    for (auto& c : result) c = alphabet[rng.below(alphabet_size)];
+    return result;
+}
+
+// Одна строка для match.txt: смесь категорий из таблицы шаблонов для отдельных слов
+void append_generated_word(DatasetRng& rng, string& out) {
+    static const char lower[] = "abcdefghijklmnopqrstuvwxyz";
+    static const char upper[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+    static const char digits[] = "0123456789";
+    static const char alnum[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+    static const char vowels[] = "aeiou";
+    static const char consonants[] = "bcdfghjklmnpqrstvwxyz";
+
+    switch (rng.below(10)) {
+        case 0:
+        case 1:
+        case 2:
+            out += random_letters(rng, rng.between(2, 12), lower, 26);
+            break;
+        case 3:
+            out += random_letters(rng, 1, upper, 26) + random_letters(rng, rng.between(2, 10), lower, 26);
+            break;
+        case 4:
+            out += random_letters(rng, rng.between(1, 10), digits, 10);
+            break;
+        case 5:
+            out += random_letters(rng, 4, alnum, sizeof(alnum) - 1);
+            break;
+        case 6:
+            out += random_letters(rng, rng.between(1, 8), lower, 26) + "ing";
+            break;
+        case 7:
+            out += random_letters(rng, 3, digits, 10) + "-" + random_letters(rng, 2, digits, 10) + "-" +
+                   random_letters(rng, 4, digits, 10);
+            break;
+        case 8:
+            out += random_letters(rng, rng.between(6, 14), alnum, sizeof(alnum) - 1);
+            break;
+        default:
+            if (rng.chance(30)) {
+                // 5-буквенный палиндром
+                string half = random_letters(rng, 2, lower, 26);
+                out += half + random_letters(rng, 1, lower, 26) + half[1] + half[0];
+            } else {
+                for (size_t i = 0, pairs = rng.between(1, 4); i < pairs; ++i) {
+                    out += random_letters(rng, 1, vowels, 5) + random_letters(rng, 1, consonants, 21);
+                }
+            }
+    }
+    out += '\n';
+}
+
+void append_prose_sentence(DatasetRng& rng, string& out, size_t& column) {
+    size_t words = rng.between(4, 32);
+    for (size_t i = 0; i < words; ++i) {
+        string word;
+        size_t kind = rng.below(100);
+        if (kind < 6) {
+            word = rng.pick(prose_names);
+        } else if (kind < 8) {
+            word = rng.pick(prose_titles) + " " + rng.pick(prose_names);
+        } else if (kind < 12) {
+            word = rng.pick(prose_theme_words);
+        } else if (kind < 13) {
+            word = to_string(rng.between(1700, 1899));
+        } else {
+            word = rng.pick(prose_common_words);
+        }
+        if (i == 0 && word[0] >= 'a' && word[0] <= 'z') {
+            word[0] = static_cast<char>(word[0] - 'a' + 'A');
+        }
+        if (i + 1 < words && rng.chance(8)) word += ',';
+        if (i + 1 == words) word += rng.pick(prose_sentence_endings);
+
+        // Перенос строк около 72 символов, как в текстах search.txt
+        if (column > 0 && column + 1 + word.size() > 72) {
+            out += '\n';
+            column = 0;
+        } else if (column > 0) {
+            out += ' ';
+            column++;
+        }
+        out += word;
+        column += word.size();
+    }
+}
+
+// Генерирует около bytes байт данных заданной формы и отдает их кусками по ~1 МБ, заканчивающимися на границе строки
+template <typename OnChunk>
+void generate_dataset(DatasetShape shape, size_t bytes, uint64_t seed, OnChunk&& on_chunk) {
+    const size_t chunk_size = 1 << 20;
+    DatasetRng rng{seed};
+    string chunk;
+    size_t produced = 0;
+    size_t line_number = 0;
+    size_t column = 0;
+
+    while (produced < bytes) {
+        size_t before = chunk.size();
+        switch (shape) {
+            case DatasetShape::Words:
+                append_generated_word(rng, chunk);
+                break;
+            case DatasetShape::FormatPaths:
+                chunk += "C:\\Users\\User\\Documents\\file" + to_string(line_number) + rng.pick(generated_extensions) + "\n";
+                break;
+            case DatasetShape::SearchPaths:
+                chunk += "/Users/files/file" + to_string(line_number / generated_extensions.size()) +
+                         generated_extensions[line_number % generated_extensions.size()] + "\n";
+                break;
+            case DatasetShape::Prose:
+                append_prose_sentence(rng, chunk, column);
+                if (rng.chance(15)) {
+                    chunk += "\n\n";
+                    column = 0;
+                }
+                break;
+        }
+        line_number++;
+        produced += chunk.size() - before;
+
+        if (chunk.size() >= chunk_size) {
+            on_chunk(string_view(chunk));
+            chunk.clear();
+        }
+    }
+    if (!chunk.empty()) on_chunk(string_view(chunk));
+}
+
+string generate_dataset(DatasetShape shape, size_t bytes, uint64_t seed) {
+    string data;
+    data.reserve(bytes + 256);
+    generate_dataset(shape, bytes, seed, [&](string_view chunk) { data.append(chunk); });
+    return data;
+}
+
+string format_bytes(size_t bytes) {
+    char buffer[32];
+    if (bytes >= (1u << 30)) {
+        snprintf(buffer, sizeof(buffer), "%.1f GB", bytes / double(1u << 30));
+    } else if (bytes >= (1u << 20)) {
+        snprintf(buffer, sizeof(buffer), "%.1f MB", bytes / double(1u << 20));
+    } else {
+        snprintf(buffer, sizeof(buffer), "%.1f KB", bytes / 1024.0);
+    }
+    return buffer;
+}
+
+// Размер из аргумента командной строки: число (можно дробное) с необязательным суффиксом K, M или G - 64K, 16M, 2G.
+// Знак, лишние символы, ноль и значения больше limit отвергаются
+size_t parse_size(const string& text, size_t limit) {
+    size_t pos = 0;
+    while (pos < text.size() && (isdigit(static_cast<unsigned char>(text[pos])) || text[pos] == '.')) pos++;
+    string number = text.substr(0, pos);
+    if (number.empty() || count(number.begin(), number.end(), '.') > 1 || number == ".") {
+        throw invalid_argument("not a size: " + text);
+    }
+    char suffix = pos < text.size() ? static_cast<char>(toupper(static_cast<unsigned char>(text[pos]))) : ' ';
+    if (pos + 1 < text.size() || (pos < text.size() && suffix != 'K' && suffix != 'M' && suffix != 'G')) {
+        throw invalid_argument("not a size: " + text);
+    }
+    double scale = suffix == 'K' ? 1024.0 : suffix == 'M' ? 1024.0 * 1024 : suffix == 'G' ? 1024.0 * 1024 * 1024 : 1.0;
+    double value = stod(number) * scale;
+    if (value < 1 || value > static_cast<double>(limit)) {
+        throw out_of_range("size " + text + " is not between 1 byte and " + format_bytes(limit));
+    }
+    return static_cast<size_t>(value);
+}
+
+// Целое число из аргумента командной строки; в отличие от stoul отвергает знак и лишние символы
+size_t parse_count(const string& text) {
+    if (text.empty() || !all_of(text.begin(), text.end(), [](unsigned char c) { return isdigit(c); })) {
+        throw invalid_argument("not a non-negative integer: " + text);
+    }
+    return stoull(text);
+}
+
+// Самый большой набор данных в репозитории - 272 МБ; ограничение защищает от опечаток вроде лишнего нуля
+const size_t generate_max_bytes = size_t(64) << 30;
+
+// Режим "generate": MyProject generate <words|paths|search-paths|prose> <size> <output> [seed]
+int run_generate_mode(int argc, char* argv[]) {
+    if (argc < 5) {
+        cerr << "Usage: " << argv[0] << " generate <words|paths|search-paths|prose> <size> <output> [seed]\n";
+        return 1;
+    }
+    auto shape = find_if(dataset_shapes.begin(), dataset_shapes.end(), [&](const auto& item) { return item.first == argv[2]; });
+    if (shape == dataset_shapes.end()) {
+        cerr << "Unknown dataset shape " << argv[2] << "\n";
+        return 1;
+    }
+    size_t bytes = 0;
+    uint64_t seed = 42;
+    try {
+        bytes = parse_size(argv[3], generate_max_bytes);
+        if (argc > 5) seed = parse_count(argv[5]);
+    } catch (const exception& e) {
+        cerr << "Invalid argument: " << e.what() << "\n";
+        cerr << "Usage: " << argv[0] << " generate <words|paths|search-paths|prose> <size> <output> [seed]\n";
+        return 1;
+    }
+
+    ofstream out(argv[4], ios::binary);
+    if (!out) {
+        cerr << "Cannot open " << argv[4] << "\n";
+        return 1;
+    }
+
+    auto start = high_resolution_clock::now();
+    size_t written = 0;
+    generate_dataset(shape->second, bytes, seed, [&](string_view chunk) {
+        out.write(chunk.data(), chunk.size());
+        written += chunk.size();
+    });
+    auto duration = duration_cast<milliseconds>(high_resolution_clock::now() - start);
+
+    cout << "Generated " << written << " bytes of " << shape->first << " (seed " << seed << ") into "
+         << argv[4] << " in " << duration.count() << " ms\n";
+    return 0;
+}
+
 void print_test_result(const TestResult& result) {
     printf("| %-8s | %-12s | %-30s | %7d | %9lld |\n",
            result.operation.c_str(),
@@ -304,15 +1111,192 @@ void test_re2_match(const vector<string>& words, const string& pattern_name, con
     }
 }
 
+// Глобальный обход совпадений.
+// Каждая функция перебирает все непересекающиеся совпадения во всем тексте, не разрезая его,
+// поэтому \b и look-behind видят контекст перед текущей позицией. on_match получает массив групп
+// (string_view в исходный текст, у несовпавшей группы data() == nullptr) и их количество.
+// Возвращается число совпадений.
+template <typename OnMatch>
+size_t std_regex_for_each_match(const regex& re, string_view text, size_t nsubmatch, OnMatch&& on_match) {
+    vector<string_view> groups(nsubmatch);
+    size_t matches = 0;
+    cregex_iterator it(text.data(), text.data() + text.size(), re);
+    cregex_iterator end;
+    for (; it != end; ++it) {
+        const cmatch& match = *it;
+        size_t count = min(nsubmatch, match.size());
+        for (size_t i = 0; i < count; ++i) {
+            groups[i] = match[i].matched ? string_view(match[i].first, match[i].length()) : string_view();
+        }
+        matches++;
+        on_match(groups.data(), count);
+    }
+    return matches;
+}
+
+template <typename OnMatch>
+size_t boost_regex_for_each_match(const boost::regex& re, string_view text, size_t nsubmatch, OnMatch&& on_match) {
+    vector<string_view> groups(nsubmatch);
+    size_t matches = 0;
+    // match_not_dot_newline выравнивает семантику '.' с остальными движками
+    boost::cregex_iterator it(text.data(), text.data() + text.size(), re, boost::match_not_dot_newline);
+    boost::cregex_iterator end;
+    for (; it != end; ++it) {
+        const boost::cmatch& match = *it;
+        size_t count = min(nsubmatch, match.size());
+        for (size_t i = 0; i < count; ++i) {
+            groups[i] = match[i].matched ? string_view(match[i].first, match[i].length()) : string_view();
+        }
+        matches++;
+        on_match(groups.data(), count);
+    }
+    return matches;
+}
+
+using PcreCodePtr = unique_ptr<pcre2_code, decltype(&pcre2_code_free)>;
+
+// Компиляция шаблона PCRE2, общая для всех режимов. При ошибке возвращает пустой указатель,
+// а текст ошибки PCRE записывает в error, если он передан
+PcreCodePtr compile_pcre_pattern(const string& pattern, bool jit, string* error = nullptr, uint32_t options = 0,
+                                 pcre2_compile_context* context = nullptr) {
+    int errnum;
+    PCRE2_SIZE erroff;
+    pcre2_code* re = pcre2_compile(
+        (PCRE2_SPTR8)pattern.c_str(),
+        PCRE2_ZERO_TERMINATED,
+        options,
+        &errnum,
+        &erroff,
+        context
+    );
+    if (!re && error) {
+        PCRE2_UCHAR buffer[256];
+        pcre2_get_error_message(errnum, buffer, sizeof(buffer));
+        *error = reinterpret_cast<const char*>(buffer);
+    }
+    if (re && jit) {
+        pcre2_jit_compile(re, PCRE2_JIT_COMPLETE);
+    }
+    return PcreCodePtr(re, pcre2_code_free);
+}
+
+// Число передаваемых групп определяется размером match_data
+template <typename OnMatch>
+size_t pcre_for_each_match(const pcre2_code* re, pcre2_match_data* match_data, string_view text, OnMatch&& on_match) {
+    uint32_t pattern_options = 0;
+    pcre2_pattern_info(re, PCRE2_INFO_ALLOPTIONS, &pattern_options);
+    bool utf = (pattern_options & PCRE2_UTF) != 0;
+
+    PCRE2_SIZE* ovector = pcre2_get_ovector_pointer(match_data);
+    uint32_t pairs = pcre2_get_ovector_count(match_data);
+    vector<string_view> groups(pairs);
+    size_t matches = 0;
+    size_t offset = 0;
+    uint32_t options = 0;
+
+    while (offset <= text.size()) {
+        int rc = pcre2_match(
+            re,
+            (PCRE2_SPTR8)text.data(),
+            text.size(),
+            offset,
+            options,
+            match_data,
+            nullptr
+        );
+
+        if (rc == PCRE2_ERROR_NOMATCH && options != 0) {
+            // На этой позиции было пустое совпадение, а непустого нет - сдвигаемся на один символ
+            offset++;
+            while (utf && offset < text.size() && (text[offset] & 0xC0) == 0x80) {
+                offset++;
+            }
+            options = 0;
+            continue;
+        }
+        if (rc < 0) break;
+
+        size_t count = rc == 0 ? pairs : static_cast<size_t>(rc);
+        for (size_t i = 0; i < count; ++i) {
+            groups[i] = ovector[2 * i] == PCRE2_UNSET
+                ? string_view()
+                : string_view(text.data() + ovector[2 * i], ovector[2 * i + 1] - ovector[2 * i]);
+        }
+        matches++;
+        on_match(groups.data(), count);
+
+        // После пустого совпадения повторяем поиск с той же позиции, запрещая пустое совпадение в начале
+        offset = ovector[1];
+        options = ovector[0] == ovector[1] ? PCRE2_NOTEMPTY_ATSTART | PCRE2_ANCHORED : 0;
+    }
+    return matches;
+}
+
+// nsubmatch >= 1: RE2 нужна хотя бы группа 0, чтобы знать, где продолжать поиск.
+// У RE2 нет аналога PCRE2_NOTEMPTY_ATSTART, поэтому после пустого совпадения поиск продолжается
+// со следующего символа; для шаблонов, где пустое совпадение предпочтительнее непустого на той же
+// позиции (например, a??), результат может отличаться от PCRE
+template <typename OnMatch>
+size_t re2_for_each_match(const RE2& re, string_view text, int nsubmatch, OnMatch&& on_match) {
+    bool utf = re.options().encoding() == RE2::Options::EncodingUTF8;
+    re2::StringPiece input(text.data(), text.size());
+    vector<re2::StringPiece> pieces(nsubmatch);
+    vector<string_view> groups(nsubmatch);
+    size_t matches = 0;
+    size_t offset = 0;
+
+    while (offset <= text.size() &&
+           re.Match(input, offset, text.size(), RE2::UNANCHORED, pieces.data(), nsubmatch)) {
+        for (int i = 0; i < nsubmatch; ++i) {
+            groups[i] = pieces[i].data() == nullptr ? string_view() : string_view(pieces[i].data(), pieces[i].size());
+        }
+        matches++;
+        on_match(groups.data(), static_cast<size_t>(nsubmatch));
+
+        offset = pieces[0].data() - text.data() + pieces[0].size();
+        if (pieces[0].empty()) {
+            offset++;
+            while (utf && offset < text.size() && (text[offset] & 0xC0) == 0x80) {
+                offset++;
+            }
+        }
+    }
+    return matches;
+}
+
+// Проверка, что все движки нашли одинаковое число совпадений для паттерна
+void verify_match_counts(const string& operation, const string& pattern_name) {
+    const TestResult* reference = nullptr;
+    bool agree = true;
+    for (const auto& result : all_results) {
+        if (result.operation != operation || result.pattern_name != pattern_name) continue;
+        if (!reference) {
+            reference = &result;
+        } else if (result.matches != reference->matches) {
+            agree = false;
+        }
+    }
+    if (!reference) return;
+
+    if (agree) {
+        cout << "Counts agree across engines: " << reference->matches << "\n";
+        return;
+    }
+    cout << "COUNT MISMATCH for " << operation << " '" << pattern_name << "':";
+    for (const auto& result : all_results) {
+        if (result.operation == operation && result.pattern_name == pattern_name) {
+            cout << " " << result.library << "=" << result.matches;
+        }
+    }
+    cout << "\n";
+}
+
 void test_std_regex_search(const string& text, const string& pattern_name, const string& pattern) {
     try {
         regex re(pattern);
-        size_t matches = 0;
         
         auto start = high_resolution_clock::now();
-        sregex_iterator it(text.begin(), text.end(), re);
-        sregex_iterator end;
-        matches = distance(it, end);
+        size_t matches = std_regex_for_each_match(re, text, 1, [](const string_view*, size_t) {});
         auto end_time = high_resolution_clock::now();
         
         auto duration = duration_cast<microseconds>(end_time - start);
@@ -327,12 +1311,9 @@ void test_std_regex_search(const string& text, const string& pattern_name, const
 void test_boost_regex_search(const string& text, const string& pattern_name, const string& pattern) {
     try {
         boost::regex re(pattern);
-        size_t matches = 0;
         
         auto start = high_resolution_clock::now();
-        boost::sregex_iterator it(text.begin(), text.end(), re);
-        boost::sregex_iterator end;
-        matches = distance(it, end);
+        size_t matches = boost_regex_for_each_match(re, text, 1, [](const string_view*, size_t) {});
         auto end_time = high_resolution_clock::now();
         
         auto duration = duration_cast<microseconds>(end_time - start);
@@ -346,48 +1327,17 @@ void test_boost_regex_search(const string& text, const string& pattern_name, con
 
 void test_pcre_search(const string& text, const string& pattern_name, const string& pattern) {
     try {
-        int errnum;
-        PCRE2_SIZE erroff;
-        pcre2_code* re = pcre2_compile(
-            (PCRE2_SPTR8)pattern.c_str(),
-            PCRE2_ZERO_TERMINATED,
-            0,
-            &errnum,
-            &erroff,
-            nullptr
-        );
-        
+        string error;
+        PcreCodePtr re = compile_pcre_pattern(pattern, false, &error);
         if (!re) {
-            PCRE2_UCHAR buffer[256];
-            pcre2_get_error_message(errnum, buffer, sizeof(buffer));
-            cerr << "PCRE compilation failed for pattern '" << pattern << "': " << buffer << endl;
+            cerr << "PCRE compilation failed for pattern '" << pattern << "': " << error << endl;
             return;
         }
         
-        pcre2_match_data* match_data = pcre2_match_data_create_from_pattern(re, nullptr);
-        size_t matches = 0;
-        size_t offset = 0;
-        size_t length = text.length();
-        const char* subject = text.c_str();
+        pcre2_match_data* match_data = pcre2_match_data_create(1, nullptr);
         
         auto start = high_resolution_clock::now();
-        while (offset < length) {
-            int rc = pcre2_match(
-                re,
-                (PCRE2_SPTR8)(subject + offset),
-                length - offset,
-                0,
-                0,
-                match_data,
-                nullptr
-            );
-            
-            if (rc < 0) break;
-            
-            matches++;
-            PCRE2_SIZE* ovector = pcre2_get_ovector_pointer(match_data);
-            offset += ovector[1];
-        }
+        size_t matches = pcre_for_each_match(re.get(), match_data, text, [](const string_view*, size_t) {});
         auto end_time = high_resolution_clock::now();
         
         auto duration = duration_cast<microseconds>(end_time - start);
@@ -396,7 +1346,6 @@ void test_pcre_search(const string& text, const string& pattern_name, const stri
         print_test_result(result);
         
         pcre2_match_data_free(match_data);
-        pcre2_code_free(re);
     } catch (const exception& e) {
         cerr << "PCRE search error with pattern '" << pattern << "': " << e.what() << endl;
     }
@@ -410,13 +1359,8 @@ void test_re2_search(const string& text, const string& pattern_name, const strin
             return;
         }
         
-        size_t matches = 0;
-        re2::StringPiece input(text);
-        
         auto start = high_resolution_clock::now();
-        while (RE2::FindAndConsume(&input, re)) {
-            matches++;
-        }
+        size_t matches = re2_for_each_match(re, text, 1, [](const string_view*, size_t) {});
         auto end_time = high_resolution_clock::now();
         
         auto duration = duration_cast<microseconds>(end_time - start);
@@ -428,356 +1372,3537 @@ void test_re2_search(const string& text, const string& pattern_name, const strin
     }
 }
 
-//паттерн для извлечения расширений файлов
-const string file_extension_pattern = R"((?:\.([a-zA-Z0-9]+))$)";
+// Режимы извлечения захватов: только подсчет, смещения (string_view) и материализованные подстроки
+enum class CaptureMode { Count, Offsets, Submatches };
 
-// Функции для тестирования извлечения расширений
-void test_std_regex_extensions(const vector<string>& paths) {
+const vector<CaptureMode> capture_modes = {CaptureMode::Count, CaptureMode::Offsets, CaptureMode::Submatches};
+
+const char* capture_mode_name(CaptureMode mode) {
+    switch (mode) {
+        case CaptureMode::Count: return "count";
+        case CaptureMode::Offsets: return "offsets";
+        case CaptureMode::Submatches: return "submatch";
+    }
+    return "";
+}
+
+// Потребитель групп для матрицы захватов: складывает смещения или копии подстрок
+struct CaptureSink {
+    CaptureMode mode;
+    vector<string_view> offsets;
+    vector<string> submatches;
+
+    void operator()(const string_view* groups, size_t count) {
+        if (mode == CaptureMode::Count) return;
+        for (size_t i = 0; i < count; ++i) {
+            if (groups[i].data() == nullptr) continue;
+            if (mode == CaptureMode::Offsets) {
+                offsets.push_back(groups[i]);
+            } else {
+                submatches.emplace_back(groups[i]);
+            }
+        }
+    }
+};
+
+// Функции для тестирования стоимости извлечения захватов
+void test_std_regex_capture(const string& text, const string& pattern_name, const string& pattern, CaptureMode mode) {
     try {
-        regex re(file_extension_pattern);
-        unordered_set<string> extensions;
-        
+        regex re(pattern);
+        CaptureSink sink{mode, {}, {}};
+        size_t nsubmatch = mode == CaptureMode::Count ? 1 : re.mark_count() + 1;
+
         auto start = high_resolution_clock::now();
-        for (const auto& path : paths) {
-            smatch match;
-            if (regex_search(path, match, re) && match.size() > 1) {
-                extensions.insert(match[1].str());
-            }
-        }
-        auto end = high_resolution_clock::now();
-        
-        auto duration = duration_cast<microseconds>(end - start);
-        TestResult result{"extract", "std::regex", "File extensions", duration.count(), static_cast<int>(extensions.size())};
+        size_t matches = std_regex_for_each_match(re, text, nsubmatch, ref(sink));
+        auto end_time = high_resolution_clock::now();
+
+        auto duration = duration_cast<microseconds>(end_time - start);
+        TestResult result{capture_mode_name(mode), "std::regex", pattern_name, duration.count(), static_cast<int>(matches)};
         all_results.push_back(result);
         print_test_result(result);
-        
-        // Вывод уникальных расширений
-        cout << "std::regex found " << extensions.size() << " unique extensions:\n";
-        for (const auto& ext : extensions) {
-            cout << ext << " ";
-        }
-        cout << "\n\n";
     } catch (const exception& e) {
-        cerr << "std::regex extensions error: " << e.what() << endl;
+        cerr << "std::regex capture error with pattern '" << pattern << "': " << e.what() << endl;
     }
 }
 
-void test_boost_regex_extensions(const vector<string>& paths) {
+void test_boost_regex_capture(const string& text, const string& pattern_name, const string& pattern, CaptureMode mode) {
     try {
-        boost::regex re(file_extension_pattern);
-        unordered_set<string> extensions;
-        
+        boost::regex re(pattern);
+        CaptureSink sink{mode, {}, {}};
+        // match_any здесь не используется: он меняет границы совпадений и число итераций
+        size_t nsubmatch = mode == CaptureMode::Count ? 1 : re.mark_count() + 1;
+
         auto start = high_resolution_clock::now();
-        for (const auto& path : paths) {
-            boost::smatch match;
-            if (boost::regex_search(path, match, re) && match.size() > 1) {
-                extensions.insert(match[1].str());
-            }
-        }
-        auto end = high_resolution_clock::now();
-        
-        auto duration = duration_cast<microseconds>(end - start);
-        TestResult result{"extract", "boost::regex", "File extensions", duration.count(), static_cast<int>(extensions.size())};
+        size_t matches = boost_regex_for_each_match(re, text, nsubmatch, ref(sink));
+        auto end_time = high_resolution_clock::now();
+
+        auto duration = duration_cast<microseconds>(end_time - start);
+        TestResult result{capture_mode_name(mode), "boost::regex", pattern_name, duration.count(), static_cast<int>(matches)};
         all_results.push_back(result);
         print_test_result(result);
-        
-        cout << "boost::regex found " << extensions.size() << " unique extensions:\n";
-        for (const auto& ext : extensions) {
-            cout << ext << " ";
-        }
-        cout << "\n\n";
     } catch (const exception& e) {
-        cerr << "boost::regex extensions error: " << e.what() << endl;
+        cerr << "boost::regex capture error with pattern '" << pattern << "': " << e.what() << endl;
     }
 }
 
-void test_pcre_extensions(const vector<string>& paths) {
+void test_pcre_capture(const string& text, const string& pattern_name, const string& pattern, CaptureMode mode) {
     try {
-        int errnum;
-        PCRE2_SIZE erroff;
-        pcre2_code* re = pcre2_compile(
-            (PCRE2_SPTR8)file_extension_pattern.c_str(),
-            PCRE2_ZERO_TERMINATED,
-            0,
-            &errnum,
-            &erroff,
-            nullptr
-        );
-        
+        string error;
+        PcreCodePtr re = compile_pcre_pattern(pattern, false, &error);
         if (!re) {
-            PCRE2_UCHAR buffer[256];
-            pcre2_get_error_message(errnum, buffer, sizeof(buffer));
-            cerr << "PCRE compilation failed: " << buffer << endl;
+            cerr << "PCRE compilation failed for pattern '" << pattern << "': " << error << endl;
             return;
         }
-        
-        pcre2_match_data* match_data = pcre2_match_data_create_from_pattern(re, nullptr);
-        unordered_set<string> extensions;
-        
+
+        // Для подсчета достаточно одной пары в ovector - границ всего совпадения
+        pcre2_match_data* match_data = mode == CaptureMode::Count
+            ? pcre2_match_data_create(1, nullptr)
+            : pcre2_match_data_create_from_pattern(re.get(), nullptr);
+        CaptureSink sink{mode, {}, {}};
+
         auto start = high_resolution_clock::now();
-        for (const auto& path : paths) {
-            int rc = pcre2_match(
-                re,
-                (PCRE2_SPTR8)path.c_str(),
-                path.length(),
-                0,
-                0,
-                match_data,
-                nullptr
-            );
-            
-            if (rc > 1) {
-                PCRE2_SIZE* ovector = pcre2_get_ovector_pointer(match_data);
-                size_t start = ovector[2];
-                size_t end = ovector[3];
-                if (start != PCRE2_UNSET && end != PCRE2_UNSET) {
-                    extensions.insert(path.substr(start, end - start));
-                }
-            }
-        }
+        size_t matches = pcre_for_each_match(re.get(), match_data, text, ref(sink));
         auto end_time = high_resolution_clock::now();
-        
+
         auto duration = duration_cast<microseconds>(end_time - start);
-        TestResult result{"extract", "PCRE", "File extensions", duration.count(), static_cast<int>(extensions.size())};
+        TestResult result{capture_mode_name(mode), "PCRE", pattern_name, duration.count(), static_cast<int>(matches)};
         all_results.push_back(result);
         print_test_result(result);
-        
-        cout << "PCRE found " << extensions.size() << " unique extensions:\n";
-        for (const auto& ext : extensions) {
-            cout << ext << " ";
-        }
-        cout << "\n\n";
-        
+
         pcre2_match_data_free(match_data);
-        pcre2_code_free(re);
     } catch (const exception& e) {
-        cerr << "PCRE extensions error: " << e.what() << endl;
+        cerr << "PCRE capture error with pattern '" << pattern << "': " << e.what() << endl;
     }
 }
 
-void test_re2_extensions(const vector<string>& paths) {
+void test_re2_capture(const string& text, const string& pattern_name, const string& pattern, CaptureMode mode) {
     try {
-        RE2 re(file_extension_pattern);
+        RE2 re(pattern);
         if (!re.ok()) {
-            cerr << "RE2 compilation failed: " << re.error() << endl;
+            cerr << "RE2 compilation failed for pattern '" << pattern << "': " << re.error() << endl;
             return;
         }
-        
-        unordered_set<string> extensions;
-        string ext;
-        
+
+        // Для подсчета запрашиваем только группу 0: RE2 тогда не запускает NFA для подгрупп
+        int nsubmatch = mode == CaptureMode::Count ? 1 : re.NumberOfCapturingGroups() + 1;
+        CaptureSink sink{mode, {}, {}};
+
         auto start = high_resolution_clock::now();
-        for (const auto& path : paths) {
-            if (RE2::PartialMatch(path, re, &ext)) {
-                extensions.insert(ext);
-            }
-        }
+        size_t matches = re2_for_each_match(re, text, nsubmatch, ref(sink));
         auto end_time = high_resolution_clock::now();
-        
+
         auto duration = duration_cast<microseconds>(end_time - start);
-        TestResult result{"extract", "RE2", "File extensions", duration.count(), static_cast<int>(extensions.size())};
+        TestResult result{capture_mode_name(mode), "RE2", pattern_name, duration.count(), static_cast<int>(matches)};
         all_results.push_back(result);
         print_test_result(result);
-        
-        cout << "RE2 found " << extensions.size() << " unique extensions:\n";
-        for (const auto& ext : extensions) {
-            cout << ext << " ";
+    } catch (const exception& e) {
+        cerr << "RE2 capture error with pattern '" << pattern << "': " << e.what() << endl;
+    }
+}
+
+const TestResult* find_result(const string& operation, const string& library, const string& pattern_name) {
+    for (const auto& result : all_results) {
+        if (result.operation == operation && result.library == library && result.pattern_name == pattern_name) {
+            return &result;
+        }
+    }
+    return nullptr;
+}
+
+// Сводная таблица: во сколько раз смещения и подстроки дороже простого подсчета
+void print_capture_matrix(const vector<pair<string, string>>& patterns) {
+    const vector<string> libraries = {"std::regex", "boost::regex", "PCRE", "RE2"};
+    cout << "\n| Library      | Pattern Name                   |   Count μs | Offsets μs | Submatch μs | Offs/Cnt | Sub/Cnt |\n";
+    cout << "|--------------|--------------------------------|------------|------------|-------------|----------|---------|\n";
+    for (const auto& [name, pattern] : patterns) {
+        for (const auto& library : libraries) {
+            const TestResult* count = find_result("count", library, name);
+            const TestResult* offsets = find_result("offsets", library, name);
+            const TestResult* submatches = find_result("submatch", library, name);
+            if (!count || !offsets || !submatches) continue;
+            double base = max<long long>(count->time_us, 1);
+            printf("| %-12s | %-30s | %10lld | %10lld | %11lld | %7.2fx | %6.2fx |\n",
+                   library.c_str(),
+                   name.c_str(),
+                   count->time_us,
+                   offsets->time_us,
+                   submatches->time_us,
+                   offsets->time_us / base,
+                   submatches->time_us / base);
+        }
+    }
+}
+
+void run_capture_matrix(const string& text, const vector<pair<string, string>>& patterns) {
+    print_results_header();
+    for (const auto& [name, pattern] : patterns) {
+        cout << "\nTesting pattern: " << name << " (" << pattern << ")\n";
+        for (CaptureMode mode : capture_modes) {
+            test_std_regex_capture(text, name, pattern, mode);
+            test_boost_regex_capture(text, name, pattern, mode);
+            test_pcre_capture(text, name, pattern, mode);
+            test_re2_capture(text, name, pattern, mode);
+            verify_match_counts(capture_mode_name(mode), name);
+        }
+    }
+    print_capture_matrix(patterns);
+}
+
+// Пакетный match: слова упаковываются в блоки через '\n', и на блок делается один многострочный поиск
+
+struct WordBlock {
+    string text;
+    size_t first_word;
+    vector<size_t> line_starts;
+};
+
+const size_t word_block_bytes = 64 << 10;
+
+vector<WordBlock> pack_word_blocks(const vector<string>& words, size_t block_bytes) {
+    vector<WordBlock> blocks;
+    for (size_t i = 0; i < words.size(); ++i) {
+        if (blocks.empty() || blocks.back().text.size() + words[i].size() + 1 > block_bytes) {
+            blocks.push_back({string(), i, {}});
+            blocks.back().text.reserve(block_bytes);
+        }
+        WordBlock& block = blocks.back();
+        block.line_starts.push_back(block.text.size());
+        block.text += words[i];
+        block.text += '\n';
+    }
+    return blocks;
+}
+
+// В многострочном режиме отрицательный класс вроде [^aeiou] совпадает с '\n' и может склеить соседние слова,
+// поэтому '\n' добавляется во все отрицательные классы
+string to_line_pattern(const string& pattern) {
+    string result;
+    for (size_t i = 0; i < pattern.size(); ++i) {
+        result += pattern[i];
+        if (pattern[i] == '\\' && i + 1 < pattern.size()) {
+            result += pattern[++i];
+        } else if (pattern[i] == '[' && i + 1 < pattern.size() && pattern[i + 1] == '^') {
+            result += "^\\n";
+            ++i;
+        }
+    }
+    return result;
+}
+
+// Переводит совпадение в блоке в номер слова; совпадения, захватившие перевод строки, отбрасываются.
+// Совпадения идут по возрастанию позиции, поэтому повторы одного слова отсекаются сравнением с предыдущим
+struct WordHitCounter {
+    const WordBlock* block = nullptr;
+    size_t last_word = SIZE_MAX;
+    size_t words = 0;
+
+    void operator()(const string_view* groups, size_t) {
+        const string_view& match = groups[0];
+        if (match.find('\n') != string_view::npos) return;
+        size_t offset = match.data() - block->text.data();
+        auto line = upper_bound(block->line_starts.begin(), block->line_starts.end(), offset) - 1;
+        size_t word = block->first_word + (line - block->line_starts.begin());
+        if (word != last_word) {
+            last_word = word;
+            words++;
+        }
+    }
+};
+
+void report_batched_match(const string& library, const string& pattern_name, long long time_us, size_t matches) {
+    TestResult result{"batched", library, pattern_name, time_us, static_cast<int>(matches)};
+    all_results.push_back(result);
+    print_test_result(result);
+
+    const TestResult* per_word = find_result("match", library, pattern_name);
+    if (!per_word) return;
+    if (per_word->matches != result.matches) {
+        cout << "COUNT MISMATCH for " << library << " '" << pattern_name << "': per-word=" << per_word->matches
+             << " batched=" << result.matches << "\n";
+    }
+}
+
+// Функции для тестирования пакетного match
+void test_std_regex_batched_match(const vector<WordBlock>& blocks, const string& pattern_name, const string& pattern) {
+    try {
+        regex re(to_line_pattern(pattern), regex::ECMAScript | regex::multiline);
+        WordHitCounter counter;
+
+        auto start = high_resolution_clock::now();
+        for (const auto& block : blocks) {
+            counter.block = &block;
+            std_regex_for_each_match(re, block.text, 1, ref(counter));
+        }
+        auto end = high_resolution_clock::now();
+
+        report_batched_match("std::regex", pattern_name, duration_cast<microseconds>(end - start).count(), counter.words);
+    } catch (const exception& e) {
+        cerr << "std::regex batched match error with pattern '" << pattern << "': " << e.what() << endl;
+    }
+}
+
+void test_boost_regex_batched_match(const vector<WordBlock>& blocks, const string& pattern_name, const string& pattern) {
+    try {
+        // В perl-синтаксисе boost ^ и $ и так срабатывают на границах строк, '.' ограничен match_not_dot_newline
+        boost::regex re(to_line_pattern(pattern));
+        WordHitCounter counter;
+
+        auto start = high_resolution_clock::now();
+        for (const auto& block : blocks) {
+            counter.block = &block;
+            boost_regex_for_each_match(re, block.text, 1, ref(counter));
+        }
+        auto end = high_resolution_clock::now();
+
+        report_batched_match("boost::regex", pattern_name, duration_cast<microseconds>(end - start).count(), counter.words);
+    } catch (const exception& e) {
+        cerr << "boost::regex batched match error with pattern '" << pattern << "': " << e.what() << endl;
+    }
+}
+
+void test_pcre_batched_match(const vector<WordBlock>& blocks, const string& pattern_name, const string& pattern) {
+    try {
+        string error;
+        PcreCodePtr re = compile_pcre_pattern(to_line_pattern(pattern), false, &error, PCRE2_MULTILINE);
+        if (!re) {
+            cerr << "PCRE compilation failed for pattern '" << pattern << "': " << error << endl;
+            return;
+        }
+
+        pcre2_match_data* match_data = pcre2_match_data_create(1, nullptr);
+        WordHitCounter counter;
+
+        auto start = high_resolution_clock::now();
+        for (const auto& block : blocks) {
+            counter.block = &block;
+            pcre_for_each_match(re.get(), match_data, block.text, ref(counter));
+        }
+        auto end = high_resolution_clock::now();
+
+        report_batched_match("PCRE", pattern_name, duration_cast<microseconds>(end - start).count(), counter.words);
+
+        pcre2_match_data_free(match_data);
+    } catch (const exception& e) {
+        cerr << "PCRE batched match error with pattern '" << pattern << "': " << e.what() << endl;
+    }
+}
+
+void test_re2_batched_match(const vector<WordBlock>& blocks, const string& pattern_name, const string& pattern) {
+    try {
+        // posix_syntax + one_line=false дает многострочные ^ и $; \d, \w и \b включаются отдельно
+        RE2::Options options;
+        options.set_posix_syntax(true);
+        options.set_one_line(false);
+        options.set_perl_classes(true);
+        options.set_word_boundary(true);
+        RE2 re(to_line_pattern(pattern), options);
+        if (!re.ok()) {
+            cerr << "RE2 compilation failed for pattern '" << pattern << "': " << re.error() << endl;
+            return;
+        }
+
+        WordHitCounter counter;
+
+        auto start = high_resolution_clock::now();
+        for (const auto& block : blocks) {
+            counter.block = &block;
+            re2_for_each_match(re, block.text, 1, ref(counter));
+        }
+        auto end = high_resolution_clock::now();
+
+        report_batched_match("RE2", pattern_name, duration_cast<microseconds>(end - start).count(), counter.words);
+    } catch (const exception& e) {
+        cerr << "RE2 batched match error with pattern '" << pattern << "': " << e.what() << endl;
+    }
+}
+
+// Сводная таблица: выигрыш от одного вызова движка на блок вместо вызова на слово
+void print_batched_gain(const vector<pair<string, string>>& patterns) {
+    const vector<string> libraries = {"std::regex", "boost::regex", "PCRE", "RE2"};
+    cout << "\n| Library      | Pattern Name                   | Per-word μs | Batched μs |   Gain |\n";
+    cout << "|--------------|--------------------------------|-------------|------------|--------|\n";
+    for (const auto& [name, pattern] : patterns) {
+        for (const auto& library : libraries) {
+            const TestResult* per_word = find_result("match", library, name);
+            const TestResult* batched = find_result("batched", library, name);
+            if (!per_word || !batched) continue;
+            printf("| %-12s | %-30s | %11lld | %10lld | %5.2fx |\n",
+                   library.c_str(),
+                   name.c_str(),
+                   per_word->time_us,
+                   batched->time_us,
+                   per_word->time_us / static_cast<double>(max<long long>(batched->time_us, 1)));
+        }
+    }
+}
+
+// Замена и токенизация: здесь движки различаются в основном тем, как материализуют результат,
+// поэтому кроме пропускной способности выводится число выделений памяти за проход
+
+struct RedactionPattern {
+    string name;
+    string pattern;
+    string replacement;  // в синтаксисе $1; для RE2 переводится в \1
+};
+
+const vector<RedactionPattern> redaction_patterns = {
+    {"Redact years", R"(\b1[0-9]{3}\b)", "YYYY"},
+    {"Redact surnames", R"(\b[A-Z][a-z]*(ov|ev|in|sky|aya)\b)", "[NAME]"},
+    {"Redact titled names", R"(\b(Prince|Count|Countess|Baron|Duchess)\s+[A-Z][a-z]+)", "$1 [REDACTED]"},
+    {"Redact numbers", R"(\d+)", "#"}
+};
+
+// Кириллица в классах символов ведет себя по-разному в байтовых движках, поэтому имена после титула берутся через \S+.
+// Шаблоны рассчитаны на UTF-8: если search_russian.txt в другой кодировке, они ничего не находят, и замена
+// вырождается в чистое сканирование - поэтому run_rewrite_workloads печатает число подстановок
+const vector<RedactionPattern> redaction_russian_patterns = {
+    {"Скрыть годы", R"(\b1[0-9]{3}\b)", "YYYY"},
+    {"Скрыть титулованных", R"((князь|граф|графиня|барон|герцог)\s+\S+)", "$1 [СКРЫТО]"},
+    {"Скрыть прямую речь", R"(— [^.!?\n]*[.!?])", "— [...]"},
+    {"Скрыть числа", R"(\d+)", "#"}
+};
+
+const string tokenize_pattern = R"(\w+)";
+
+string to_re2_rewrite(const string& replacement) {
+    string rewrite;
+    for (size_t i = 0; i < replacement.size(); ++i) {
+        if (replacement[i] == '$' && i + 1 < replacement.size() && isdigit(static_cast<unsigned char>(replacement[i + 1]))) {
+            rewrite += '\\';
+        } else {
+            if (replacement[i] == '\\') rewrite += '\\';
+            rewrite += replacement[i];
+        }
+    }
+    return rewrite;
+}
+
+// PCRE2 выделяет память через malloc, а не operator new, поэтому для учета ему передается свой аллокатор
+void* pcre_counting_malloc(PCRE2_SIZE size, void*) {
+    void* ptr = malloc(size);
+    if (ptr && allocation_counters.enabled) {
+        allocation_counters.allocations++;
+        allocation_counters.allocated_bytes += allocated_size(ptr);
+        allocation_counters.live_bytes += allocated_size(ptr);
+    }
+    return ptr;
+}
+
+void pcre_counting_free(void* ptr, void*) {
+    if (!ptr) return;
+    if (allocation_counters.enabled) allocation_counters.live_bytes -= allocated_size(ptr);
+    free(ptr);
+}
+
+struct AllocationWindow {
+    AllocationScope scope;
+    AllocationCounters start = allocation_counters;
+
+    size_t allocations() const { return allocation_counters.allocations - start.allocations; }
+    long long allocated_bytes() const { return allocation_counters.allocated_bytes - start.allocated_bytes; }
+};
+
+void print_rewrite_header() {
+    cout << "| Operation | Library      | Pattern Name                   |    Output |   MB/s |   Allocs | Alloc MB |\n";
+    cout << "|-----------|--------------|--------------------------------|-----------|--------|----------|----------|\n";
+}
+
+// Output: для replace - длина результата в байтах, для tokenize - число токенов.
+// Оно же идет в поле matches, чтобы verify_match_counts сверял движки между собой
+void report_rewrite(const string& operation, const string& library, const string& pattern_name, long long time_us,
+                    size_t input_bytes, size_t output, const AllocationWindow& window) {
+    all_results.push_back({operation, library, pattern_name, time_us, static_cast<int>(output)});
+    printf("| %-9s | %-12s | %-30s | %9zu | %6.1f | %8zu | %8.2f |\n",
+           operation.c_str(),
+           library.c_str(),
+           pattern_name.c_str(),
+           output,
+           input_bytes / 1e6 / (max<long long>(time_us, 1) / 1e6),
+           window.allocations(),
+           window.allocated_bytes() / 1e6);
+}
+
+// Функции для тестирования replace
+void test_std_regex_replace(const string& text, const RedactionPattern& redaction) {
+    try {
+        regex re(redaction.pattern);
+
+        AllocationWindow window;
+        auto start = high_resolution_clock::now();
+        string result = regex_replace(text, re, redaction.replacement);
+        auto end = high_resolution_clock::now();
+
+        report_rewrite("replace", "std::regex", redaction.name, duration_cast<microseconds>(end - start).count(),
+                       text.size(), result.size(), window);
+    } catch (const exception& e) {
+        cerr << "std::regex replace error with pattern '" << redaction.pattern << "': " << e.what() << endl;
+    }
+}
+
+void test_boost_regex_replace(const string& text, const RedactionPattern& redaction) {
+    try {
+        boost::regex re(redaction.pattern);
+
+        AllocationWindow window;
+        auto start = high_resolution_clock::now();
+        string result = boost::regex_replace(text, re, redaction.replacement, boost::match_not_dot_newline);
+        auto end = high_resolution_clock::now();
+
+        report_rewrite("replace", "boost::regex", redaction.name, duration_cast<microseconds>(end - start).count(),
+                       text.size(), result.size(), window);
+    } catch (const exception& e) {
+        cerr << "boost::regex replace error with pattern '" << redaction.pattern << "': " << e.what() << endl;
+    }
+}
+
+// Выходной буфер передается снаружи и переиспользуется между шаблонами; если его не хватает,
+// PCRE2_SUBSTITUTE_OVERFLOW_LENGTH сообщает нужный размер, и подстановка повторяется один раз.
+// Возвращает число подстановок или -1 при ошибке
+int test_pcre_replace(const string& text, const RedactionPattern& redaction, vector<PCRE2_UCHAR>& output) {
+    int substitutions = -1;
+    try {
+        pcre2_general_context* context = pcre2_general_context_create(pcre_counting_malloc, pcre_counting_free, nullptr);
+        pcre2_compile_context* compile_context = pcre2_compile_context_create(context);
+        string error;
+        PcreCodePtr compiled = compile_pcre_pattern(redaction.pattern, false, &error, 0, compile_context);
+        pcre2_compile_context_free(compile_context);
+
+        if (!compiled) {
+            cerr << "PCRE compilation failed for pattern '" << redaction.pattern << "': " << error << endl;
+            pcre2_general_context_free(context);
+            return substitutions;
+        }
+
+        pcre2_code* re = compiled.get();
+        pcre2_match_data* match_data = pcre2_match_data_create_from_pattern(re, context);
+        const uint32_t options = PCRE2_SUBSTITUTE_GLOBAL | PCRE2_SUBSTITUTE_OVERFLOW_LENGTH;
+
+        AllocationWindow window;
+        auto start = high_resolution_clock::now();
+        PCRE2_SIZE length = output.size();
+        int rc = pcre2_substitute(re, (PCRE2_SPTR8)text.data(), text.size(), 0, options, match_data, nullptr,
+                                  (PCRE2_SPTR8)redaction.replacement.data(), redaction.replacement.size(),
+                                  output.data(), &length);
+        if (rc == PCRE2_ERROR_NOMEMORY) {
+            output.resize(length);
+            rc = pcre2_substitute(re, (PCRE2_SPTR8)text.data(), text.size(), 0, options, match_data, nullptr,
+                                  (PCRE2_SPTR8)redaction.replacement.data(), redaction.replacement.size(),
+                                  output.data(), &length);
+        }
+        auto end = high_resolution_clock::now();
+
+        if (rc < 0) {
+            PCRE2_UCHAR buffer[256];
+            pcre2_get_error_message(rc, buffer, sizeof(buffer));
+            cerr << "PCRE substitute failed for pattern '" << redaction.pattern << "': " << buffer << endl;
+        } else {
+            substitutions = rc;
+            report_rewrite("replace", "PCRE", redaction.name, duration_cast<microseconds>(end - start).count(),
+                           text.size(), length, window);
+        }
+
+        pcre2_match_data_free(match_data);
+        compiled.reset();
+        pcre2_general_context_free(context);
+    } catch (const exception& e) {
+        cerr << "PCRE replace error with pattern '" << redaction.pattern << "': " << e.what() << endl;
+    }
+    return substitutions;
+}
+
+void test_re2_replace(const string& text, const RedactionPattern& redaction) {
+    try {
+        RE2 re(redaction.pattern);
+        if (!re.ok()) {
+            cerr << "RE2 compilation failed for pattern '" << redaction.pattern << "': " << re.error() << endl;
+            return;
+        }
+        string rewrite = to_re2_rewrite(redaction.replacement);
+
+        // GlobalReplace меняет строку на месте, поэтому копия входа входит в замер наравне с результатом других движков
+        AllocationWindow window;
+        auto start = high_resolution_clock::now();
+        string result = text;
+        RE2::GlobalReplace(&result, re, rewrite);
+        auto end = high_resolution_clock::now();
+
+        report_rewrite("replace", "RE2", redaction.name, duration_cast<microseconds>(end - start).count(),
+                       text.size(), result.size(), window);
+    } catch (const exception& e) {
+        cerr << "RE2 replace error with pattern '" << redaction.pattern << "': " << e.what() << endl;
+    }
+}
+
+// Токены - string_view в исходный текст, частоты слов собираются в хеш-таблицу
+using WordFrequencies = unordered_map<string_view, size_t>;
+
+void report_tokenize(const string& library, const string& pattern_name, long long time_us, const string& text,
+                     const WordFrequencies& frequencies, const AllocationWindow& window) {
+    size_t tokens = 0;
+    for (const auto& entry : frequencies) tokens += entry.second;
+    report_rewrite("tokenize", library, pattern_name, time_us, text.size(), tokens, window);
+}
+
+// Функции для тестирования tokenize
+void test_std_regex_tokenize(const string& text, const string& pattern_name) {
+    try {
+        regex re(tokenize_pattern);
+
+        AllocationWindow window;
+        auto start = high_resolution_clock::now();
+        WordFrequencies frequencies;
+        for (sregex_token_iterator it(text.begin(), text.end(), re), end; it != end; ++it) {
+            frequencies[string_view(&*it->first, it->length())]++;
+        }
+        auto end = high_resolution_clock::now();
+
+        report_tokenize("std::regex", pattern_name, duration_cast<microseconds>(end - start).count(), text, frequencies, window);
+    } catch (const exception& e) {
+        cerr << "std::regex tokenize error: " << e.what() << endl;
+    }
+}
+
+void test_boost_regex_tokenize(const string& text, const string& pattern_name) {
+    try {
+        boost::regex re(tokenize_pattern);
+
+        AllocationWindow window;
+        auto start = high_resolution_clock::now();
+        WordFrequencies frequencies;
+        for (boost::sregex_token_iterator it(text.begin(), text.end(), re), end; it != end; ++it) {
+            frequencies[string_view(&*it->first, it->length())]++;
+        }
+        auto end = high_resolution_clock::now();
+
+        report_tokenize("boost::regex", pattern_name, duration_cast<microseconds>(end - start).count(), text, frequencies, window);
+    } catch (const exception& e) {
+        cerr << "boost::regex tokenize error: " << e.what() << endl;
+    }
+}
+
+void test_pcre_tokenize(const string& text, const string& pattern_name) {
+    try {
+        pcre2_general_context* context = pcre2_general_context_create(pcre_counting_malloc, pcre_counting_free, nullptr);
+        pcre2_compile_context* compile_context = pcre2_compile_context_create(context);
+        string error;
+        PcreCodePtr compiled = compile_pcre_pattern(tokenize_pattern, false, &error, 0, compile_context);
+        pcre2_compile_context_free(compile_context);
+
+        if (!compiled) {
+            cerr << "PCRE compilation failed for pattern '" << tokenize_pattern << "': " << error << endl;
+            pcre2_general_context_free(context);
+            return;
+        }
+
+        pcre2_code* re = compiled.get();
+
+        AllocationWindow window;
+        auto start = high_resolution_clock::now();
+        pcre2_match_data* match_data = pcre2_match_data_create(1, context);
+        WordFrequencies frequencies;
+        pcre_for_each_match(re, match_data, text, [&](const string_view* groups, size_t) {
+            frequencies[groups[0]]++;
+        });
+        pcre2_match_data_free(match_data);
+        auto end = high_resolution_clock::now();
+
+        report_tokenize("PCRE", pattern_name, duration_cast<microseconds>(end - start).count(), text, frequencies, window);
+
+        compiled.reset();
+        pcre2_general_context_free(context);
+    } catch (const exception& e) {
+        cerr << "PCRE tokenize error: " << e.what() << endl;
+    }
+}
+
+void test_re2_tokenize(const string& text, const string& pattern_name) {
+    try {
+        RE2 re(tokenize_pattern);
+        if (!re.ok()) {
+            cerr << "RE2 compilation failed for pattern '" << tokenize_pattern << "': " << re.error() << endl;
+            return;
+        }
+
+        AllocationWindow window;
+        auto start = high_resolution_clock::now();
+        WordFrequencies frequencies;
+        re2_for_each_match(re, text, 1, [&](const string_view* groups, size_t) {
+            frequencies[groups[0]]++;
+        });
+        auto end = high_resolution_clock::now();
+
+        report_tokenize("RE2", pattern_name, duration_cast<microseconds>(end - start).count(), text, frequencies, window);
+    } catch (const exception& e) {
+        cerr << "RE2 tokenize error: " << e.what() << endl;
+    }
+}
+
+void run_rewrite_workloads(const string& text, const vector<RedactionPattern>& redactions, const string& tokenize_name) {
+    print_rewrite_header();
+    vector<PCRE2_UCHAR> pcre_output(text.size() + text.size() / 4);
+    for (const auto& redaction : redactions) {
+        cout << "\nTesting pattern: " << redaction.name << " (" << redaction.pattern << " -> " << redaction.replacement << ")\n";
+
+        test_std_regex_replace(text, redaction);
+        test_boost_regex_replace(text, redaction);
+        int substitutions = test_pcre_replace(text, redaction, pcre_output);
+        test_re2_replace(text, redaction);
+        verify_match_counts("replace", redaction.name);
+        if (substitutions == 0) {
+            cout << "Substitutions: 0 (the pattern does not occur in the text, replace measured a pure scan)\n";
+        } else if (substitutions > 0) {
+            cout << "Substitutions: " << substitutions << "\n";
+        }
+    }
+
+    cout << "\nTesting pattern: " << tokenize_name << " (" << tokenize_pattern << ")\n";
+    test_std_regex_tokenize(text, tokenize_name);
+    test_boost_regex_tokenize(text, tokenize_name);
+    test_pcre_tokenize(text, tokenize_name);
+    test_re2_tokenize(text, tokenize_name);
+    verify_match_counts("tokenize", tokenize_name);
+}
+
+//паттерн для извлечения расширений файлов
+const string file_extension_pattern = R"((?:\.([a-zA-Z0-9]+))$)";
+
+// Функции для тестирования извлечения расширений
+void test_std_regex_extensions(const vector<string>& paths) {
+    try {
+        regex re(file_extension_pattern);
+        unordered_set<string> extensions;
+        
+        auto start = high_resolution_clock::now();
+        for (const auto& path : paths) {
+            smatch match;
+            if (regex_search(path, match, re) && match.size() > 1) {
+                extensions.insert(match[1].str());
+            }
+        }
+        auto end = high_resolution_clock::now();
+        
+        auto duration = duration_cast<microseconds>(end - start);
+        TestResult result{"extract", "std::regex", "File extensions", duration.count(), static_cast<int>(extensions.size())};
+        all_results.push_back(result);
+        print_test_result(result);
+        
+        // Вывод уникальных расширений
+        cout << "std::regex found " << extensions.size() << " unique extensions:\n";
+        for (const auto& ext : extensions) {
+            cout << ext << " ";
+        }
+        cout << "\n\n";
+    } catch (const exception& e) {
+        cerr << "std::regex extensions error: " << e.what() << endl;
+    }
+}
+
+void test_boost_regex_extensions(const vector<string>& paths) {
+    try {
+        boost::regex re(file_extension_pattern);
+        unordered_set<string> extensions;
+        
+        auto start = high_resolution_clock::now();
+        for (const auto& path : paths) {
+            boost::smatch match;
+            if (boost::regex_search(path, match, re) && match.size() > 1) {
+                extensions.insert(match[1].str());
+            }
+        }
+        auto end = high_resolution_clock::now();
+        
+        auto duration = duration_cast<microseconds>(end - start);
+        TestResult result{"extract", "boost::regex", "File extensions", duration.count(), static_cast<int>(extensions.size())};
+        all_results.push_back(result);
+        print_test_result(result);
+        
+        cout << "boost::regex found " << extensions.size() << " unique extensions:\n";
+        for (const auto& ext : extensions) {
+            cout << ext << " ";
+        }
+        cout << "\n\n";
+    } catch (const exception& e) {
+        cerr << "boost::regex extensions error: " << e.what() << endl;
+    }
+}
+
+void test_pcre_extensions(const vector<string>& paths) {
+    try {
+        int errnum;
+        PCRE2_SIZE erroff;
+        pcre2_code* re = pcre2_compile(
+            (PCRE2_SPTR8)file_extension_pattern.c_str(),
+            PCRE2_ZERO_TERMINATED,
+            0,
+            &errnum,
+            &erroff,
+            nullptr
+        );
+        
+        if (!re) {
+            PCRE2_UCHAR buffer[256];
+            pcre2_get_error_message(errnum, buffer, sizeof(buffer));
+            cerr << "PCRE compilation failed: " << buffer << endl;
+            return;
+        }
+        
+        pcre2_match_data* match_data = pcre2_match_data_create_from_pattern(re, nullptr);
+        unordered_set<string> extensions;
+        
+        auto start = high_resolution_clock::now();
+        for (const auto& path : paths) {
+            int rc = pcre2_match(
+                re,
+                (PCRE2_SPTR8)path.c_str(),
+                path.length(),
+                0,
+                0,
+                match_data,
+                nullptr
+            );
+            
+            if (rc > 1) {
+                PCRE2_SIZE* ovector = pcre2_get_ovector_pointer(match_data);
+                size_t start = ovector[2];
+                size_t end = ovector[3];
+                if (start != PCRE2_UNSET && end != PCRE2_UNSET) {
+                    extensions.insert(path.substr(start, end - start));
+                }
+            }
+        }
+        auto end_time = high_resolution_clock::now();
+        
+        auto duration = duration_cast<microseconds>(end_time - start);
+        TestResult result{"extract", "PCRE", "File extensions", duration.count(), static_cast<int>(extensions.size())};
+        all_results.push_back(result);
+        print_test_result(result);
+        
+        cout << "PCRE found " << extensions.size() << " unique extensions:\n";
+        for (const auto& ext : extensions) {
+            cout << ext << " ";
+        }
+        cout << "\n\n";
+        
+        pcre2_match_data_free(match_data);
+        pcre2_code_free(re);
+    } catch (const exception& e) {
+        cerr << "PCRE extensions error: " << e.what() << endl;
+    }
+}
+
+void test_re2_extensions(const vector<string>& paths) {
+    try {
+        RE2 re(file_extension_pattern);
+        if (!re.ok()) {
+            cerr << "RE2 compilation failed: " << re.error() << endl;
+            return;
+        }
+        
+        unordered_set<string> extensions;
+        string ext;
+        
+        auto start = high_resolution_clock::now();
+        for (const auto& path : paths) {
+            if (RE2::PartialMatch(path, re, &ext)) {
+                extensions.insert(ext);
+            }
+        }
+        auto end_time = high_resolution_clock::now();
+        
+        auto duration = duration_cast<microseconds>(end_time - start);
+        TestResult result{"extract", "RE2", "File extensions", duration.count(), static_cast<int>(extensions.size())};
+        all_results.push_back(result);
+        print_test_result(result);
+        
+        cout << "RE2 found " << extensions.size() << " unique extensions:\n";
+        for (const auto& ext : extensions) {
+            cout << ext << " ";
+        }
+        cout << "\n\n";
+    } catch (const exception& e) {
+        cerr << "RE2 extensions error: " << e.what() << endl;
+    }
+}
+
+string get_filename_without_extension(const string& path) {
+    size_t last_slash = path.find_last_of("/\\");
+    size_t last_dot = path.find_last_of('.');
+    
+    if (last_dot != string::npos && (last_slash == string::npos || last_dot > last_slash)) {
+        return path.substr(last_slash == string::npos ? 0 : last_slash + 1, 
+                          last_dot - (last_slash == string::npos ? 0 : last_slash + 1));
+    }
+    return path.substr(last_slash == string::npos ? 0 : last_slash + 1);
+}
+
+// Шаблон для поиска файлов по имени без учета расширения
+const string filename_pattern = R"(^.*[\\/](file\d+)(?:\.[a-zA-Z0-9]+)?$)";
+
+// Функции для тестирования поиска файлов по имени
+void test_std_regex_find_files(const vector<string>& paths, const string& filename) {
+    try {
+        string pattern = R"(^.*[\\/]()" + filename + R"()(?:\.[a-zA-Z0-9]+)?$)";
+        regex re(pattern);
+        vector<string> found_files;
+        
+        auto start = high_resolution_clock::now();
+        for (const auto& path : paths) {
+            smatch match;
+            if (regex_search(path, match, re) && match.size() > 1) {
+                found_files.push_back(path);
+            }
+        }
+        auto end = high_resolution_clock::now();
+        
+        auto duration = duration_cast<microseconds>(end - start);
+        TestResult result{"find_file", "std::regex", "Find by name", duration.count(), static_cast<int>(found_files.size())};
+        all_results.push_back(result);
+        print_test_result(result);
+        
+        // Вывод первых 5 найденных файлов (если есть)
+        if (!found_files.empty()) {
+            cout << "std::regex found " << found_files.size() << " files. Examples:\n";
+            for (size_t i = 0; i < min(found_files.size(), size_t(5)); ++i) {
+                cout << "  " << found_files[i] << "\n";
+            }
+            if (found_files.size() > 5) cout << "  ...\n";
+        }
+        cout << "\n";
+    } catch (const exception& e) {
+        cerr << "std::regex find files error: " << e.what() << endl;
+    }
+}
+
+void test_boost_regex_find_files(const vector<string>& paths, const string& filename) {
+    try {
+        string pattern = R"(^.*[\\/]()" + filename + R"()(?:\.[a-zA-Z0-9]+)?$)";
+        boost::regex re(pattern);
+        vector<string> found_files;
+        
+        auto start = high_resolution_clock::now();
+        for (const auto& path : paths) {
+            boost::smatch match;
+            if (boost::regex_search(path, match, re) && match.size() > 1) {
+                found_files.push_back(path);
+            }
+        }
+        auto end = high_resolution_clock::now();
+        
+        auto duration = duration_cast<microseconds>(end - start);
+        TestResult result{"find_file", "boost::regex", "Find by name", duration.count(), static_cast<int>(found_files.size())};
+        all_results.push_back(result);
+        print_test_result(result);
+        
+        if (!found_files.empty()) {
+            cout << "boost::regex found " << found_files.size() << " files. Examples:\n";
+            for (size_t i = 0; i < min(found_files.size(), size_t(5)); ++i) {
+                cout << "  " << found_files[i] << "\n";
+            }
+            if (found_files.size() > 5) cout << "  ...\n";
+        }
+        cout << "\n";
+    } catch (const exception& e) {
+        cerr << "boost::regex find files error: " << e.what() << endl;
+    }
+}
+
+void test_pcre_find_files(const vector<string>& paths, const string& filename) {
+    try {
+        string pattern = R"(^.*[\\/]()" + filename + R"()(?:\.[a-zA-Z0-9]+)?$)";
+        int errnum;
+        PCRE2_SIZE erroff;
+        pcre2_code* re = pcre2_compile(
+            (PCRE2_SPTR8)pattern.c_str(),
+            PCRE2_ZERO_TERMINATED,
+            0,
+            &errnum,
+            &erroff,
+            nullptr
+        );
+        
+        if (!re) {
+            PCRE2_UCHAR buffer[256];
+            pcre2_get_error_message(errnum, buffer, sizeof(buffer));
+            cerr << "PCRE compilation failed: " << buffer << endl;
+            return;
+        }
+        
+        pcre2_match_data* match_data = pcre2_match_data_create_from_pattern(re, nullptr);
+        vector<string> found_files;
+        
+        auto start = high_resolution_clock::now();
+        for (const auto& path : paths) {
+            int rc = pcre2_match(
+                re,
+                (PCRE2_SPTR8)path.c_str(),
+                path.length(),
+                0,
+                0,
+                match_data,
+                nullptr
+            );
+            
+            if (rc > 1) {
+                PCRE2_SIZE* ovector = pcre2_get_ovector_pointer(match_data);
+                size_t start_pos = ovector[2];
+                size_t end_pos = ovector[3];
+                if (start_pos != PCRE2_UNSET && end_pos != PCRE2_UNSET) {
+                    found_files.push_back(path);
+                }
+            }
+        }
+        auto end_time = high_resolution_clock::now();
+        
+        auto duration = duration_cast<microseconds>(end_time - start);
+        TestResult result{"find_file", "PCRE", "Find by name", duration.count(), static_cast<int>(found_files.size())};
+        all_results.push_back(result);
+        print_test_result(result);
+        
+        if (!found_files.empty()) {
+            cout << "PCRE found " << found_files.size() << " files. Examples:\n";
+            for (size_t i = 0; i < min(found_files.size(), size_t(5)); ++i) {
+                cout << "  " << found_files[i] << "\n";
+            }
+            if (found_files.size() > 5) cout << "  ...\n";
+        }
+        cout << "\n";
+        
+        pcre2_match_data_free(match_data);
+        pcre2_code_free(re);
+    } catch (const exception& e) {
+        cerr << "PCRE find files error: " << e.what() << endl;
+    }
+}
+
+void test_re2_find_files(const vector<string>& paths, const string& filename) {
+    try {
+        string pattern = R"(^.*[\\/]()" + filename + R"()(?:\.[a-zA-Z0-9]+)?$)";
+        RE2 re(pattern);
+        if (!re.ok()) {
+            cerr << "RE2 compilation failed: " << re.error() << endl;
+            return;
+        }
+        
+        vector<string> found_files;
+        
+        auto start = high_resolution_clock::now();
+        for (const auto& path : paths) {
+            if (RE2::FullMatch(path, re)) {
+                found_files.push_back(path);
+            }
+        }
+        auto end_time = high_resolution_clock::now();
+        
+        auto duration = duration_cast<microseconds>(end_time - start);
+        TestResult result{"find_file", "RE2", "Find by name", duration.count(), static_cast<int>(found_files.size())};
+        all_results.push_back(result);
+        print_test_result(result);
+        
+        if (!found_files.empty()) {
+            cout << "RE2 found " << found_files.size() << " files. Examples:\n";
+            for (size_t i = 0; i < min(found_files.size(), size_t(5)); ++i) {
+                cout << "  " << found_files[i] << "\n";
+            }
+            if (found_files.size() > 5) cout << "  ...\n";
+        }
+        cout << "\n";
+    } catch (const exception& e) {
+        cerr << "RE2 find files error: " << e.what() << endl;
+    }
+}
+
+
+// Конвейер чтение -> сопоставление над наборами данных, разбитыми на части
+
+// Ограниченная lock-free MPMC очередь (схема Д. Вьюкова) для передачи блоков между потоками
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity) : cells_(round_up_to_power_of_two(capacity)), mask_(cells_.size() - 1) {
+        for (size_t i = 0; i < cells_.size(); ++i) {
+            cells_[i].sequence.store(i, memory_order_relaxed);
+        }
+    }
+
+    // value перемещается в очередь только при успехе
+    bool try_push(T& value) {
+        Cell* cell;
+        size_t pos = tail_.load(memory_order_relaxed);
+        for (;;) {
+            cell = &cells_[pos & mask_];
+            size_t sequence = cell->sequence.load(memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (tail_.compare_exchange_weak(pos, pos + 1, memory_order_relaxed)) break;
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = tail_.load(memory_order_relaxed);
+            }
+        }
+        cell->value = move(value);
+        cell->sequence.store(pos + 1, memory_order_release);
+        return true;
+    }
+
+    bool try_pop(T& value) {
+        Cell* cell;
+        size_t pos = head_.load(memory_order_relaxed);
+        for (;;) {
+            cell = &cells_[pos & mask_];
+            size_t sequence = cell->sequence.load(memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (head_.compare_exchange_weak(pos, pos + 1, memory_order_relaxed)) break;
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = head_.load(memory_order_relaxed);
+            }
+        }
+        value = move(cell->value);
+        cell->sequence.store(pos + mask_ + 1, memory_order_release);
+        return true;
+    }
+
+private:
+    struct Cell {
+        atomic<size_t> sequence;
+        T value;
+    };
+
+    static size_t round_up_to_power_of_two(size_t value) {
+        size_t result = 2;
+        while (result < value) result <<= 1;
+        return result;
+    }
+
+    vector<Cell> cells_;
+    size_t mask_;
+    alignas(64) atomic<size_t> head_{0};
+    alignas(64) atomic<size_t> tail_{0};
+};
+
+template <typename Matcher>
+size_t count_line_matches(string_view block, Matcher& matcher) {
+    size_t matches = 0;
+    size_t pos = 0;
+    while (pos < block.size()) {
+        size_t newline = block.find('\n', pos);
+        if (newline == string_view::npos) newline = block.size();
+        string_view line = block.substr(pos, newline - pos);
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        if (matcher(line)) matches++;
+        pos = newline + 1;
+    }
+    return matches;
+}
+
+// Построчные матчеры: по экземпляру на поток, скомпилированный шаблон общий
+struct StdLineMatcher {
+    const regex* re;
+    bool operator()(string_view line) { return regex_match(line.begin(), line.end(), *re); }
+};
+
+struct BoostLineMatcher {
+    const boost::regex* re;
+    bool operator()(string_view line) { return boost::regex_match(line.begin(), line.end(), *re); }
+};
+
+struct PcreLineMatcher {
+    const pcre2_code* re;
+    pcre2_match_data* match_data;
+
+    explicit PcreLineMatcher(const pcre2_code* code)
+        : re(code), match_data(pcre2_match_data_create_from_pattern(code, nullptr)) {}
+    PcreLineMatcher(const PcreLineMatcher&) = delete;
+    PcreLineMatcher& operator=(const PcreLineMatcher&) = delete;
+    ~PcreLineMatcher() { pcre2_match_data_free(match_data); }
+
+    bool operator()(string_view line) {
+        return pcre2_match(re, (PCRE2_SPTR8)line.data(), line.size(), 0, 0, match_data, nullptr) >= 0;
+    }
+};
+
+struct Re2LineMatcher {
+    const RE2* re;
+    bool operator()(string_view line) { return RE2::FullMatch(re2::StringPiece(line.data(), line.size()), *re); }
+};
+
+struct PipelineStats {
+    long long load_us = 0;
+    long long scan_us = 0;
+    long long total_us = 0;
+    long long reader_stall_us = 0;
+    long long matcher_stall_us = 0;
+    size_t bytes = 0;
+    size_t matches = 0;
+};
+
+const size_t pipeline_block_size = 4 << 20;
+const size_t pipeline_min_block_size = 64 << 10;
+const size_t pipeline_queue_capacity = 16;
+
+// Размер блока не больше 1/8 самой маленькой части, чтобы даже набор из одного файла давал несколько блоков
+// и чтение могло перекрываться со сканированием
+size_t pipeline_block_size_for(const vector<string>& parts) {
+    size_t smallest = pipeline_block_size * 8;
+    for (const auto& part : parts) {
+        ifstream file(part, ios::binary | ios::ate);
+        if (file) smallest = min<size_t>(smallest, file.tellg());
+    }
+    return clamp(smallest / 8, pipeline_min_block_size, pipeline_block_size);
+}
+
+// Выбрасывает части из page cache, чтобы фаза загрузки читала с диска, а не копировала из памяти.
+// Работает только на Linux (posix_fadvise); возвращает false, если хотя бы одну часть сбросить не удалось
+bool drop_from_page_cache(const vector<string>& parts) {
+#if defined(__linux__)
+    bool dropped = true;
+    for (const auto& part : parts) {
+        int fd = open(part.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            dropped = false;
+            continue;
+        }
+        fdatasync(fd);
+        dropped = posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0 && dropped;
+        close(fd);
+    }
+    return dropped;
+#else
+    (void)parts;
+    return false;
+#endif
+}
+
+// Текущий подход: сначала загрузить все части, затем сканировать тем же числом потоков
+template <typename MakeMatcher>
+PipelineStats run_load_then_scan(const vector<string>& parts, size_t readers, size_t matchers, MakeMatcher make_matcher) {
+    PipelineStats stats;
+    vector<string> blocks;
+    mutex blocks_mutex;
+    atomic<size_t> next_part{0};
+    size_t block_size = pipeline_block_size_for(parts);
+    drop_from_page_cache(parts);
+
+    auto start = high_resolution_clock::now();
+    vector<thread> threads;
+    for (size_t r = 0; r < readers; ++r) {
+        threads.emplace_back([&] {
+            vector<string> local;
+            for (size_t i; (i = next_part.fetch_add(1)) < parts.size();) {
+                read_line_blocks(parts[i], block_size, [&](string&& block) { local.push_back(move(block)); });
+            }
+            lock_guard<mutex> lock(blocks_mutex);
+            for (auto& block : local) blocks.push_back(move(block));
+        });
+    }
+    for (auto& t : threads) t.join();
+    threads.clear();
+    auto loaded = high_resolution_clock::now();
+
+    atomic<size_t> next_block{0};
+    atomic<size_t> matches{0};
+    for (size_t m = 0; m < matchers; ++m) {
+        threads.emplace_back([&] {
+            auto matcher = make_matcher();
+            size_t local = 0;
+            for (size_t i; (i = next_block.fetch_add(1)) < blocks.size();) {
+                local += count_line_matches(blocks[i], matcher);
+            }
+            matches += local;
+        });
+    }
+    for (auto& t : threads) t.join();
+    auto end = high_resolution_clock::now();
+
+    stats.load_us = duration_cast<microseconds>(loaded - start).count();
+    stats.scan_us = duration_cast<microseconds>(end - loaded).count();
+    stats.total_us = duration_cast<microseconds>(end - start).count();
+    for (const auto& block : blocks) stats.bytes += block.size();
+    stats.matches = matches;
+    return stats;
+}
+
+// Конвейер: читатели кладут блоки в ограниченную очередь, матчеры забирают их сразу
+template <typename MakeMatcher>
+PipelineStats run_pipeline(const vector<string>& parts, size_t readers, size_t matchers, MakeMatcher make_matcher) {
+    PipelineStats stats;
+    BoundedQueue<string> queue(pipeline_queue_capacity);
+    atomic<size_t> next_part{0};
+    atomic<size_t> readers_left{readers};
+    atomic<size_t> matches{0};
+    atomic<size_t> bytes{0};
+    atomic<long long> reader_stall_ns{0};
+    atomic<long long> matcher_stall_ns{0};
+    size_t block_size = pipeline_block_size_for(parts);
+    drop_from_page_cache(parts);
+
+    auto start = high_resolution_clock::now();
+    vector<thread> threads;
+    for (size_t r = 0; r < readers; ++r) {
+        threads.emplace_back([&] {
+            long long stall_ns = 0;
+            size_t local_bytes = 0;
+            for (size_t i; (i = next_part.fetch_add(1)) < parts.size();) {
+                read_line_blocks(parts[i], block_size, [&](string&& block) {
+                    local_bytes += block.size();
+                    if (queue.try_push(block)) return;
+                    auto wait_start = steady_clock::now();
+                    while (!queue.try_push(block)) this_thread::yield();
+                    stall_ns += duration_cast<nanoseconds>(steady_clock::now() - wait_start).count();
+                });
+            }
+            reader_stall_ns += stall_ns;
+            bytes += local_bytes;
+            readers_left.fetch_sub(1, memory_order_release);
+        });
+    }
+    for (size_t m = 0; m < matchers; ++m) {
+        threads.emplace_back([&] {
+            auto matcher = make_matcher();
+            long long stall_ns = 0;
+            size_t local = 0;
+            string block;
+            for (;;) {
+                if (!queue.try_pop(block)) {
+                    auto wait_start = steady_clock::now();
+                    bool got = false;
+                    while (!(got = queue.try_pop(block))) {
+                        if (readers_left.load(memory_order_acquire) == 0) {
+                            got = queue.try_pop(block);
+                            break;
+                        }
+                        this_thread::yield();
+                    }
+                    stall_ns += duration_cast<nanoseconds>(steady_clock::now() - wait_start).count();
+                    if (!got) break;
+                }
+                local += count_line_matches(block, matcher);
+            }
+            matcher_stall_ns += stall_ns;
+            matches += local;
+        });
+    }
+    for (auto& t : threads) t.join();
+    auto end = high_resolution_clock::now();
+
+    stats.total_us = duration_cast<microseconds>(end - start).count();
+    stats.reader_stall_us = reader_stall_ns / 1000 / static_cast<long long>(readers);
+    stats.matcher_stall_us = matcher_stall_ns / 1000 / static_cast<long long>(matchers);
+    stats.bytes = bytes;
+    stats.matches = matches;
+    return stats;
+}
+
+void print_pipeline_header() {
+    cout << "| Library      | Dataset              |  Load μs |  Scan μs | Load+Scan μs | Pipeline μs | R.stall μs | M.stall μs | Speedup | Overlap | Matches |\n";
+    cout << "|--------------|----------------------|----------|----------|--------------|-------------|------------|------------|---------|---------|---------|\n";
+}
+
+// Overlap - доля более короткой фазы (загрузки или сканирования), скрытая конвейером (0-100%)
+void report_pipeline(const string& library, const string& dataset, const PipelineStats& baseline, const PipelineStats& pipelined) {
+    all_results.push_back({"load+scan", library, dataset, baseline.total_us, static_cast<int>(baseline.matches)});
+    all_results.push_back({"pipeline", library, dataset, pipelined.total_us, static_cast<int>(pipelined.matches)});
+
+    double hidden = static_cast<double>(baseline.load_us + baseline.scan_us - pipelined.total_us);
+    double overlap = clamp(hidden / max<long long>(min(baseline.load_us, baseline.scan_us), 1), 0.0, 1.0);
+    double speedup = static_cast<double>(baseline.total_us) / max<long long>(pipelined.total_us, 1);
+    printf("| %-12s | %-20s | %8lld | %8lld | %12lld | %11lld | %10lld | %10lld | %6.2fx | %6.1f%% | %7zu |\n",
+           library.c_str(),
+           dataset.c_str(),
+           baseline.load_us,
+           baseline.scan_us,
+           baseline.total_us,
+           pipelined.total_us,
+           pipelined.reader_stall_us,
+           pipelined.matcher_stall_us,
+           speedup,
+           overlap * 100.0,
+           pipelined.matches);
+    if (baseline.matches != pipelined.matches) {
+        cout << "COUNT MISMATCH for " << library << " '" << dataset << "': load+scan=" << baseline.matches
+             << " pipeline=" << pipelined.matches << "\n";
+    }
+}
+
+// Функции для тестирования конвейера
+void test_std_regex_pipeline(const vector<string>& parts, const string& dataset, const string& pattern, size_t readers, size_t matchers) {
+    try {
+        regex re(pattern);
+        auto make_matcher = [&] { return StdLineMatcher{&re}; };
+        PipelineStats baseline = run_load_then_scan(parts, readers, matchers, make_matcher);
+        PipelineStats pipelined = run_pipeline(parts, readers, matchers, make_matcher);
+        report_pipeline("std::regex", dataset, baseline, pipelined);
+    } catch (const exception& e) {
+        cerr << "std::regex pipeline error with pattern '" << pattern << "': " << e.what() << endl;
+    }
+}
+
+void test_boost_regex_pipeline(const vector<string>& parts, const string& dataset, const string& pattern, size_t readers, size_t matchers) {
+    try {
+        boost::regex re(pattern);
+        auto make_matcher = [&] { return BoostLineMatcher{&re}; };
+        PipelineStats baseline = run_load_then_scan(parts, readers, matchers, make_matcher);
+        PipelineStats pipelined = run_pipeline(parts, readers, matchers, make_matcher);
+        report_pipeline("boost::regex", dataset, baseline, pipelined);
+    } catch (const exception& e) {
+        cerr << "boost::regex pipeline error with pattern '" << pattern << "': " << e.what() << endl;
+    }
+}
+
+void test_pcre_pipeline(const vector<string>& parts, const string& dataset, const string& pattern, size_t readers, size_t matchers) {
+    try {
+        string error;
+        PcreCodePtr re = compile_pcre_pattern(pattern, false, &error);
+        if (!re) {
+            cerr << "PCRE compilation failed for pattern '" << pattern << "': " << error << endl;
+            return;
+        }
+
+        auto make_matcher = [&] { return PcreLineMatcher(re.get()); };
+        PipelineStats baseline = run_load_then_scan(parts, readers, matchers, make_matcher);
+        PipelineStats pipelined = run_pipeline(parts, readers, matchers, make_matcher);
+        report_pipeline("PCRE", dataset, baseline, pipelined);
+    } catch (const exception& e) {
+        cerr << "PCRE pipeline error with pattern '" << pattern << "': " << e.what() << endl;
+    }
+}
+
+void test_re2_pipeline(const vector<string>& parts, const string& dataset, const string& pattern, size_t readers, size_t matchers) {
+    try {
+        RE2 re(pattern);
+        if (!re.ok()) {
+            cerr << "RE2 compilation failed for pattern '" << pattern << "': " << re.error() << endl;
+            return;
+        }
+
+        auto make_matcher = [&] { return Re2LineMatcher{&re}; };
+        PipelineStats baseline = run_load_then_scan(parts, readers, matchers, make_matcher);
+        PipelineStats pipelined = run_pipeline(parts, readers, matchers, make_matcher);
+        report_pipeline("RE2", dataset, baseline, pipelined);
+    } catch (const exception& e) {
+        cerr << "RE2 pipeline error with pattern '" << pattern << "': " << e.what() << endl;
+    }
+}
+
+// Режим "pipeline": MyProject pipeline [readers] [matchers]
+int run_pipeline_mode(int argc, char* argv[]) {
+    size_t cores = max(thread::hardware_concurrency(), 2u);
+    size_t readers = 2;
+    size_t matchers = 0;
+    try {
+        if (argc > 2) readers = parse_count(argv[2]);
+        matchers = argc > 3 ? parse_count(argv[3]) : (readers < cores ? cores - readers : 1);
+    } catch (const exception&) {
+        cerr << "Usage: pipeline [readers] [matchers] (positive integers)\n";
+        return 1;
+    }
+    if (readers == 0 || matchers == 0) {
+        cerr << "readers and matchers must be at least 1\n";
+        return 1;
+    }
+
+    string search_filename = "file12345";
+    const vector<tuple<string, string, string>> datasets = {
+        {"match.txt", "Words: " + word_patterns[0].first, word_patterns[0].second},
+        {"files_search_tests.txt", "Paths: find by name", R"(^.*[\\/]()" + search_filename + R"()(?:\.[a-zA-Z0-9]+)?$)"}
+    };
+
+    cout << "\n=== Testing PIPELINED READ/MATCH (" << readers << " readers, " << matchers << " matchers) ===\n";
+
+    for (const auto& [filename, dataset, pattern] : datasets) {
+        vector<string> parts = find_dataset_parts(filename);
+        if (parts.empty()) {
+            cerr << "Cannot find " << filename << " or its parts\n";
+            continue;
+        }
+        auto broken = find_if_not(parts.begin(), parts.end(), dataset_part_intact);
+        if (broken != parts.end()) {
+            cerr << "Skipping " << dataset << ": " << *broken << " is unreadable, truncated or corrupt\n";
+            continue;
+        }
+
+        // Обе схемы начинают с файлов, сброшенных из page cache. Если сбросить нельзя, прогреваем кэш для обеих,
+        // и тогда "загрузка" - это копирование из памяти, а Overlap показывает лишь перекрытие копирования
+        cout << "\n" << filename << ": " << parts.size() << " part(s), " << format_bytes(pipeline_block_size_for(parts))
+             << " blocks";
+        if (drop_from_page_cache(parts)) {
+            cout << ", page cache dropped before each scheme\n";
+        } else {
+            cout << ", page cache could not be dropped: load times are memory copies from cached files\n";
+            for (const auto& part : parts) {
+                read_line_blocks(part, pipeline_block_size, [](string&&) {});
+            }
+        }
+        print_pipeline_header();
+
+        test_std_regex_pipeline(parts, dataset, pattern, readers, matchers);
+        test_boost_regex_pipeline(parts, dataset, pattern, readers, matchers);
+        test_pcre_pipeline(parts, dataset, pattern, readers, matchers);
+        test_re2_pipeline(parts, dataset, pattern, readers, matchers);
+    }
+    return 0;
+}
+
+// Сканирование сжатых наборов данных с потоковой распаковкой
+
+struct DecompressionStats {
+    string format;
+    size_t compressed_bytes = 0;
+    size_t plain_bytes = 0;
+    long long decompress_us = 0;
+    long long match_us = 0;
+    size_t matches = 0;
+};
+
+// Один поток: распакованный блок сразу уходит в движок. Распаковка измеряется внутри DatasetReader
+// только вокруг вызовов декодера, сопоставление - вокруг count_line_matches; чтение файла, заполнение
+// блоков и перенос хвостов строк не попадают ни в одну из величин
+template <typename MakeMatcher>
+DecompressionStats scan_compressed(const vector<string>& parts, MakeMatcher make_matcher) {
+    DecompressionStats stats;
+    auto matcher = make_matcher();
+    long long match_ns = 0;
+    long long decode_ns = 0;
+
+    for (const auto& part : parts) {
+        DatasetReader reader(part);
+        if (!reader.ok()) continue;
+        string format = reader.format_name();
+        if (stats.format.empty()) {
+            stats.format = format;
+        } else if (stats.format != format && stats.format.find(format) == string::npos) {
+            stats.format += "+" + format;
+        }
+        read_line_blocks(reader, pipeline_block_size, [&](string&& block) {
+            stats.plain_bytes += block.size();
+            auto match_start = high_resolution_clock::now();
+            stats.matches += count_line_matches(block, matcher);
+            match_ns += duration_cast<nanoseconds>(high_resolution_clock::now() - match_start).count();
+        });
+        if (reader.failed()) throw runtime_error(part + " is truncated or corrupt");
+        stats.compressed_bytes += reader.compressed_bytes();
+        decode_ns += reader.decode_ns();
+    }
+
+    stats.match_us = match_ns / 1000;
+    stats.decompress_us = decode_ns / 1000;
+    return stats;
+}
+
+void print_compressed_header() {
+    cout << "| Library      | Dataset              | Format | Ratio | Decomp MB/s | Regex MB/s | Bound  | Regex cores | Matches |\n";
+    cout << "|--------------|----------------------|--------|-------|-------------|------------|--------|-------------|---------|\n";
+}
+
+// Regex cores - сколько ядер с движком нужно, чтобы успевать за одним ядром распаковки.
+// Для несжатых частей распаковки нет, и эти колонки печатаются как "-"
+void report_compressed(const string& library, const string& dataset, const DecompressionStats& stats) {
+    all_results.push_back({"decompress", library, dataset, stats.decompress_us, static_cast<int>(stats.matches)});
+    all_results.push_back({"scan", library, dataset, stats.match_us, static_cast<int>(stats.matches)});
+
+    double megabytes = stats.plain_bytes / 1e6;
+    double regex_mbps = megabytes / max(stats.match_us / 1e6, 1e-6);
+    double ratio = static_cast<double>(stats.plain_bytes) / max<size_t>(stats.compressed_bytes, 1);
+    printf("| %-12s | %-20s | %-6s | %5.2f | ", library.c_str(), dataset.c_str(), stats.format.c_str(), ratio);
+    if (stats.format == "plain") {
+        printf("%11s | %10.1f | %-6s | %11s | %7zu |\n", "-", regex_mbps, "regex", "-", stats.matches);
+        return;
+    }
+    double decompress_mbps = megabytes / max(stats.decompress_us / 1e6, 1e-6);
+    printf("%11.1f | %10.1f | %-6s | %11.2f | %7zu |\n",
+           decompress_mbps,
+           regex_mbps,
+           stats.decompress_us > stats.match_us ? "decomp" : "regex",
+           decompress_mbps / max(regex_mbps, 1e-6),
+           stats.matches);
+}
+
+// Функции для тестирования сканирования сжатых данных
+void test_std_regex_compressed(const vector<string>& parts, const string& dataset, const string& pattern) {
+    try {
+        regex re(pattern);
+        report_compressed("std::regex", dataset, scan_compressed(parts, [&] { return StdLineMatcher{&re}; }));
+    } catch (const exception& e) {
+        cerr << "std::regex compressed scan error with pattern '" << pattern << "': " << e.what() << endl;
+    }
+}
+
+void test_boost_regex_compressed(const vector<string>& parts, const string& dataset, const string& pattern) {
+    try {
+        boost::regex re(pattern);
+        report_compressed("boost::regex", dataset, scan_compressed(parts, [&] { return BoostLineMatcher{&re}; }));
+    } catch (const exception& e) {
+        cerr << "boost::regex compressed scan error with pattern '" << pattern << "': " << e.what() << endl;
+    }
+}
+
+void test_pcre_compressed(const vector<string>& parts, const string& dataset, const string& pattern) {
+    try {
+        string error;
+        PcreCodePtr re = compile_pcre_pattern(pattern, false, &error);
+        if (!re) {
+            cerr << "PCRE compilation failed for pattern '" << pattern << "': " << error << endl;
+            return;
+        }
+
+        report_compressed("PCRE", dataset, scan_compressed(parts, [&] { return PcreLineMatcher(re.get()); }));
+    } catch (const exception& e) {
+        cerr << "PCRE compressed scan error with pattern '" << pattern << "': " << e.what() << endl;
+    }
+}
+
+void test_re2_compressed(const vector<string>& parts, const string& dataset, const string& pattern) {
+    try {
+        RE2 re(pattern);
+        if (!re.ok()) {
+            cerr << "RE2 compilation failed for pattern '" << pattern << "': " << re.error() << endl;
+            return;
+        }
+
+        report_compressed("RE2", dataset, scan_compressed(parts, [&] { return Re2LineMatcher{&re}; }));
+    } catch (const exception& e) {
+        cerr << "RE2 compressed scan error with pattern '" << pattern << "': " << e.what() << endl;
+    }
+}
+
+// Режим "compressed": MyProject compressed
+int run_compressed_mode() {
+    string search_filename = "file12345";
+    const vector<tuple<string, string, string>> datasets = {
+        {"match.txt", "Words: " + word_patterns[0].first, word_patterns[0].second},
+        {"files_search_tests.txt", "Paths: find by name", R"(^.*[\\/]()" + search_filename + R"()(?:\.[a-zA-Z0-9]+)?$)"}
+    };
+
+    cout << "\n=== Testing COMPRESSED DATASET SCAN ===\n";
+    cout << "Compiled formats: plain";
+    if (DatasetReader::format_supported(DatasetReader::Format::Gzip)) cout << ", gzip";
+    if (DatasetReader::format_supported(DatasetReader::Format::Zstd)) cout << ", zstd";
+    if (DatasetReader::format_supported(DatasetReader::Format::Lz4)) cout << ", lz4";
+    cout << "\n";
+    print_compressed_header();
+
+    for (const auto& [filename, dataset, pattern] : datasets) {
+        vector<string> parts = find_dataset_parts(filename);
+        if (parts.empty()) {
+            cerr << "Cannot find " << filename << " or its parts\n";
+            continue;
+        }
+        if (parts.size() > 1) {
+            cout << dataset << " parts:";
+            for (const auto& part : parts) cout << " " << part;
+            cout << "\n";
+        }
+        auto broken = find_if_not(parts.begin(), parts.end(), dataset_part_intact);
+        if (broken != parts.end()) {
+            cerr << "Skipping " << dataset << ": " << *broken << " is unreadable, truncated or corrupt\n";
+            continue;
+        }
+
+        test_std_regex_compressed(parts, dataset, pattern);
+        test_boost_regex_compressed(parts, dataset, pattern);
+        test_pcre_compressed(parts, dataset, pattern);
+        test_re2_compressed(parts, dataset, pattern);
+    }
+    return 0;
+}
+
+// Прогон по размерам рабочего набора: от размера L1 до гигабайт
+
+struct SweepWorkload {
+    string name;
+    DatasetShape shape;
+    string pattern;
+    bool per_line;
+};
+
+struct SweepPoint {
+    string workload;
+    string library;
+    size_t bytes;
+    double mbps;
+    size_t matches;
+};
+
+vector<SweepPoint> sweep_points;
+
+const size_t sweep_min_bytes = 16 << 10;
+// Набор данных целиком держится в памяти
+const size_t sweep_max_bytes = size_t(16) << 30;
+
+// Префикс данных длиной не больше bytes, обрезанный по границе строки
+string_view dataset_prefix(string_view data, size_t bytes) {
+    if (bytes >= data.size()) return data;
+    size_t last_newline = data.rfind('\n', bytes - 1);
+    return string_view(data.data(), last_newline == string::npos ? bytes : last_newline + 1);
+}
+
+// Повторяет проход, пока суммарное время не наберет 50 мс, чтобы малые размеры не упирались в разрешение таймера
+template <typename Scan>
+void sweep_engine(const string& library, const SweepWorkload& workload, const string& data, const vector<size_t>& sizes, Scan scan) {
+    for (size_t size : sizes) {
+        string_view view = dataset_prefix(data, size);
+        scan(view);  // прогрев кэша
+
+        size_t passes = 0;
+        size_t matches = 0;
+        auto start = high_resolution_clock::now();
+        auto elapsed = nanoseconds(0);
+        do {
+            matches = scan(view);
+            passes++;
+            elapsed = high_resolution_clock::now() - start;
+        } while (elapsed < milliseconds(50));
+
+        double seconds = duration_cast<nanoseconds>(elapsed).count() / 1e9;
+        double mbps = view.size() * passes / 1e6 / seconds;
+        sweep_points.push_back({workload.name, library, view.size(), mbps, matches});
+        all_results.push_back({"sweep", library, workload.name + " @" + to_string(view.size()),
+                               duration_cast<microseconds>(elapsed).count() / static_cast<long long>(passes),
+                               static_cast<int>(matches)});
+    }
+}
+
+// Функции для прогона по размерам
+void test_std_regex_sweep(const string& data, const SweepWorkload& workload, const vector<size_t>& sizes) {
+    try {
+        regex re(workload.pattern);
+        sweep_engine("std::regex", workload, data, sizes, [&](string_view view) {
+            if (workload.per_line) {
+                StdLineMatcher matcher{&re};
+                return count_line_matches(view, matcher);
+            }
+            return std_regex_for_each_match(re, view, 1, [](const string_view*, size_t) {});
+        });
+    } catch (const exception& e) {
+        cerr << "std::regex sweep error with pattern '" << workload.pattern << "': " << e.what() << endl;
+    }
+}
+
+void test_boost_regex_sweep(const string& data, const SweepWorkload& workload, const vector<size_t>& sizes) {
+    try {
+        boost::regex re(workload.pattern);
+        sweep_engine("boost::regex", workload, data, sizes, [&](string_view view) {
+            if (workload.per_line) {
+                BoostLineMatcher matcher{&re};
+                return count_line_matches(view, matcher);
+            }
+            return boost_regex_for_each_match(re, view, 1, [](const string_view*, size_t) {});
+        });
+    } catch (const exception& e) {
+        cerr << "boost::regex sweep error with pattern '" << workload.pattern << "': " << e.what() << endl;
+    }
+}
+
+void test_pcre_sweep(const string& data, const SweepWorkload& workload, const vector<size_t>& sizes) {
+    try {
+        string error;
+        PcreCodePtr re = compile_pcre_pattern(workload.pattern, false, &error);
+        if (!re) {
+            cerr << "PCRE compilation failed for pattern '" << workload.pattern << "': " << error << endl;
+            return;
+        }
+
+        PcreLineMatcher matcher(re.get());
+        pcre2_match_data* match_data = pcre2_match_data_create(1, nullptr);
+        sweep_engine("PCRE", workload, data, sizes, [&](string_view view) {
+            if (workload.per_line) {
+                return count_line_matches(view, matcher);
+            }
+            return pcre_for_each_match(re.get(), match_data, view, [](const string_view*, size_t) {});
+        });
+
+        pcre2_match_data_free(match_data);
+    } catch (const exception& e) {
+        cerr << "PCRE sweep error with pattern '" << workload.pattern << "': " << e.what() << endl;
+    }
+}
+
+void test_re2_sweep(const string& data, const SweepWorkload& workload, const vector<size_t>& sizes) {
+    try {
+        RE2 re(workload.pattern);
+        if (!re.ok()) {
+            cerr << "RE2 compilation failed for pattern '" << workload.pattern << "': " << re.error() << endl;
+            return;
+        }
+
+        sweep_engine("RE2", workload, data, sizes, [&](string_view view) {
+            if (workload.per_line) {
+                Re2LineMatcher matcher{&re};
+                return count_line_matches(view, matcher);
+            }
+            return re2_for_each_match(re, view, 1, [](const string_view*, size_t) {});
+        });
+    } catch (const exception& e) {
+        cerr << "RE2 sweep error with pattern '" << workload.pattern << "': " << e.what() << endl;
+    }
+}
+
+// Таблица с текстовым графиком: длина полосы пропорциональна пропускной способности
+void print_sweep_plot(const string& workload) {
+    double best = 0;
+    for (const auto& point : sweep_points) {
+        if (point.workload == workload) best = max(best, point.mbps);
+    }
+
+    cout << "\n| Library      |       Size |     MB/s | Throughput                               |\n";
+    cout << "|--------------|------------|----------|------------------------------------------|\n";
+    for (const auto& point : sweep_points) {
+        if (point.workload != workload) continue;
+        int bar = best > 0 ? static_cast<int>(point.mbps / best * 40 + 0.5) : 0;
+        printf("| %-12s | %10s | %8.1f | %-40s |\n",
+               point.library.c_str(),
+               format_bytes(point.bytes).c_str(),
+               point.mbps,
+               string(bar, '#').c_str());
+    }
+}
+
+// Режим "sweep": MyProject sweep [max_size] [seed]; точки также сохраняются в sweep.csv для построения графиков
+int run_sweep_mode(int argc, char* argv[]) {
+    size_t max_bytes = size_t(1) << 30;
+    uint64_t seed = 42;
+    try {
+        if (argc > 2) max_bytes = parse_size(argv[2], sweep_max_bytes);
+        if (argc > 3) seed = parse_count(argv[3]);
+    } catch (const exception& e) {
+        cerr << "Invalid argument: " << e.what() << "\n";
+        cerr << "Usage: " << argv[0] << " sweep [max_size] [seed]\n";
+        return 1;
+    }
+
+    vector<size_t> sizes;
+    for (size_t size = sweep_min_bytes; size < max_bytes; size *= 2) sizes.push_back(size);
+    sizes.push_back(max_bytes);
+
+    string search_filename = "file12345";
+    const vector<SweepWorkload> workloads = {
+        {"Match words", DatasetShape::Words, word_patterns[0].second, true},
+        {"Search prose", DatasetShape::Prose, war_and_peace_patterns[0].second, false},
+        {"Find paths", DatasetShape::SearchPaths, R"(^.*[\\/]()" + search_filename + R"()(?:\.[a-zA-Z0-9]+)?$)", true}
+    };
+
+    cout << "\n=== Testing THROUGHPUT vs WORKING SET (" << format_bytes(sizes.front()) << " - "
+         << format_bytes(max_bytes) << ", seed " << seed << ") ===\n";
+
+    for (const auto& workload : workloads) {
+        cout << "\nWorkload: " << workload.name << " (" << workload.pattern << ")\n";
+        string data = generate_dataset(workload.shape, max_bytes, seed);
+
+        test_std_regex_sweep(data, workload, sizes);
+        test_boost_regex_sweep(data, workload, sizes);
+        test_pcre_sweep(data, workload, sizes);
+        test_re2_sweep(data, workload, sizes);
+        print_sweep_plot(workload.name);
+    }
+
+    ofstream csv("sweep.csv");
+    csv << "workload,library,bytes,mbps,matches\n";
+    for (const auto& point : sweep_points) {
+        csv << point.workload << "," << point.library << "," << point.bytes << "," << point.mbps << "," << point.matches << "\n";
+    }
+    cout << "\nSweep points written to sweep.csv\n";
+    return 0;
+}
+
+// Массовая компиляция и сериализация скомпилированных шаблонов
+
+// Набор сгенерированных шаблонов: только синтаксис, общий для std::regex, boost, PCRE и RE2
+vector<string> generate_patterns(size_t count, uint64_t seed) {
+    static const vector<string> classes = {"[a-z]", "[A-Z]", "\\d", "\\w", "[a-zA-Z0-9]", "[aeiou]", "[^\\s]"};
+    static const vector<string> suffixes = {"ov", "ev", "in", "sky", "aya", "ing", "ed"};
+    DatasetRng rng{seed};
+    vector<string> patterns;
+    patterns.reserve(count);
+
+    auto pick_word = [&] {
+        return rng.chance(50) ? rng.pick(prose_common_words) : rng.pick(prose_theme_words);
+    };
+
+    while (patterns.size() < count) {
+        string pattern;
+        switch (rng.below(5)) {
+            case 0: {
+                pattern = "\\b(" + pick_word();
+                for (size_t i = 0, n = rng.between(1, 7); i < n; ++i) pattern += "|" + pick_word();
+                pattern += ")\\b";
+                break;
+            }
+            case 1: {
+                size_t low = rng.between(1, 6);
+                pattern = "^" + rng.pick(classes) + "{" + to_string(low) + "," + to_string(low + rng.between(0, 8)) + "}";
+                if (rng.chance(50)) pattern += "\\d+";
+                pattern += "$";
+                break;
+            }
+            case 2:
+                pattern = pick_word() + "-\\d{" + to_string(rng.between(1, 4)) + "}-" + rng.pick(classes) + "+";
+                break;
+            case 3:
+                pattern = "(" + rng.pick(classes) + "+)\\s+(" + pick_word() + "|" + pick_word() + ")";
+                break;
+            default: {
+                pattern = "\\b" + rng.pick(prose_names).substr(0, rng.between(2, 4)) + "[a-z]*(";
+                pattern += rng.pick(suffixes) + "|" + rng.pick(suffixes) + ")\\b";
+            }
+        }
+        patterns.push_back(move(pattern));
+    }
+    return patterns;
+}
+
+// Компилирует все шаблоны в threads потоках и возвращает {время, число успешно скомпилированных}.
+// Скомпилированные объекты живут до конца замера, чтобы в него не попадало их освобождение
+template <typename Compile>
+pair<long long, size_t> bulk_compile(const vector<string>& patterns, size_t threads, Compile compile) {
+    using Compiled = decltype(compile(patterns[0]));
+    vector<vector<Compiled>> compiled(threads);
+    vector<thread> workers;
+
+    auto start = high_resolution_clock::now();
+    for (size_t t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            for (size_t i = t; i < patterns.size(); i += threads) {
+                compiled[t].push_back(compile(patterns[i]));
+            }
+        });
+    }
+    for (auto& worker : workers) worker.join();
+    auto end = high_resolution_clock::now();
+
+    size_t ok = 0;
+    for (const auto& part : compiled) {
+        for (const auto& item : part) {
+            if (item) ok++;
+        }
+    }
+    return {duration_cast<microseconds>(end - start).count(), ok};
+}
+
+void record_bulk_result(const string& operation, const string& library, size_t pattern_count, size_t threads, long long time_us, size_t ok) {
+    string name = to_string(pattern_count) + " patterns, " + to_string(threads) + (threads == 1 ? " thread" : " threads");
+    TestResult result{operation, library, name, time_us, static_cast<int>(ok)};
+    all_results.push_back(result);
+    print_test_result(result);
+}
+
+// Функции для тестирования массовой компиляции
+void test_std_regex_bulk_compile(const vector<string>& patterns, size_t threads) {
+    auto [time_us, ok] = bulk_compile(patterns, threads, [](const string& pattern) {
+        try {
+            return make_unique<regex>(pattern);
+        } catch (const exception&) {
+            return unique_ptr<regex>();
+        }
+    });
+    record_bulk_result("bulk", "std::regex", patterns.size(), threads, time_us, ok);
+}
+
+void test_boost_regex_bulk_compile(const vector<string>& patterns, size_t threads) {
+    auto [time_us, ok] = bulk_compile(patterns, threads, [](const string& pattern) {
+        try {
+            return make_unique<boost::regex>(pattern);
+        } catch (const exception&) {
+            return unique_ptr<boost::regex>();
+        }
+    });
+    record_bulk_result("bulk", "boost::regex", patterns.size(), threads, time_us, ok);
+}
+
+bool pcre_jit_available() {
+    uint32_t jit = 0;
+    pcre2_config(PCRE2_CONFIG_JIT, &jit);
+    return jit != 0;
+}
+
+void test_pcre_bulk_compile(const vector<string>& patterns, size_t threads) {
+    auto [time_us, ok] = bulk_compile(patterns, threads, [](const string& pattern) {
+        return compile_pcre_pattern(pattern, false);
+    });
+    record_bulk_result("bulk", "PCRE", patterns.size(), threads, time_us, ok);
+
+    if (pcre_jit_available()) {
+        auto [jit_time_us, jit_ok] = bulk_compile(patterns, threads, [](const string& pattern) {
+            return compile_pcre_pattern(pattern, true);
+        });
+        record_bulk_result("bulk+jit", "PCRE", patterns.size(), threads, jit_time_us, jit_ok);
+    }
+}
+
+void test_re2_bulk_compile(const vector<string>& patterns, size_t threads) {
+    auto [time_us, ok] = bulk_compile(patterns, threads, [](const string& pattern) {
+        RE2::Options options;
+        options.set_log_errors(false);
+        auto re = make_unique<RE2>(pattern, options);
+        if (!re->ok()) re.reset();
+        return re;
+    });
+    record_bulk_result("bulk", "RE2", patterns.size(), threads, time_us, ok);
+}
+
+// Сериализация PCRE2: компиляция -> pcre2_serialize_encode -> файл -> pcre2_serialize_decode (+JIT).
+// Сериализованные данные переносимы только между сборками PCRE2 одной версии и конфигурации
+// false, если файл не удалось записать или прочитать обратно, либо PCRE2 отверг данные
+bool test_pcre_serialize(const vector<string>& patterns, const string& filename) {
+    vector<PcreCodePtr> compiled;
+    vector<const pcre2_code*> codes;
+    for (const auto& pattern : patterns) {
+        compiled.push_back(compile_pcre_pattern(pattern, false));
+        if (compiled.back()) codes.push_back(compiled.back().get());
+    }
+
+    auto start = high_resolution_clock::now();
+    uint8_t* bytes = nullptr;
+    PCRE2_SIZE size = 0;
+    int32_t encoded = pcre2_serialize_encode(codes.data(), static_cast<int32_t>(codes.size()), &bytes, &size, nullptr);
+    if (encoded < 0) {
+        PCRE2_UCHAR buffer[256];
+        pcre2_get_error_message(encoded, buffer, sizeof(buffer));
+        cerr << "PCRE serialize failed: " << buffer << endl;
+        return false;
+    }
+    {
+        ofstream out(filename, ios::binary);
+        if (!out) {
+            cerr << "Cannot open " << filename << " for writing" << endl;
+            pcre2_serialize_free(bytes);
+            return false;
+        }
+        out.write(reinterpret_cast<const char*>(bytes), size);
+        out.close();
+        if (!out) {
+            cerr << "Failed to write " << size << " bytes to " << filename << endl;
+            pcre2_serialize_free(bytes);
+            return false;
+        }
+    }
+    auto end = high_resolution_clock::now();
+    pcre2_serialize_free(bytes);
+    record_bulk_result("encode", "PCRE", patterns.size(), 1, duration_cast<microseconds>(end - start).count(), encoded);
+    cout << "Serialized " << encoded << " PCRE2 patterns into " << filename << " (" << size << " bytes)\n";
+
+    // Холодный старт: чтение файла и декодирование
+    start = high_resolution_clock::now();
+    string data = read_file_to_string(filename);
+    // Декодер не знает длины буфера, поэтому неполные данные до него не доходят
+    if (data.size() < size) {
+        cerr << "Read back " << data.size() << " of " << size << " serialized bytes from " << filename << endl;
+        return false;
+    }
+    const uint8_t* input = reinterpret_cast<const uint8_t*>(data.data());
+    int32_t count = pcre2_serialize_get_number_of_codes(input);
+    if (count < 0) {
+        PCRE2_UCHAR buffer[256];
+        pcre2_get_error_message(count, buffer, sizeof(buffer));
+        cerr << "PCRE serialized data rejected: " << buffer << endl;
+        return false;
+    }
+    vector<pcre2_code*> decoded(count);
+    int32_t decoded_count = pcre2_serialize_decode(decoded.data(), count, input, nullptr);
+    end = high_resolution_clock::now();
+    if (decoded_count < 0) {
+        PCRE2_UCHAR buffer[256];
+        pcre2_get_error_message(decoded_count, buffer, sizeof(buffer));
+        cerr << "PCRE deserialize failed: " << buffer << endl;
+        return false;
+    }
+    record_bulk_result("decode", "PCRE", patterns.size(), 1, duration_cast<microseconds>(end - start).count(), decoded_count);
+
+    // JIT-код не сериализуется и компилируется заново после декодирования
+    if (pcre_jit_available()) {
+        start = high_resolution_clock::now();
+        for (auto* code : decoded) {
+            pcre2_jit_compile(code, PCRE2_JIT_COMPLETE);
+        }
+        end = high_resolution_clock::now();
+        record_bulk_result("jit", "PCRE", patterns.size(), 1, duration_cast<microseconds>(end - start).count(), decoded_count);
+    }
+
+    for (auto* code : decoded) {
+        pcre2_code_free(code);
+    }
+    return true;
+}
+
+// Режим "serialize": MyProject serialize [patterns] [threads] [file]
+int run_serialize_mode(int argc, char* argv[]) {
+    size_t pattern_count = 5000;
+    size_t threads = max(thread::hardware_concurrency(), 1u);
+    try {
+        if (argc > 2) pattern_count = parse_count(argv[2]);
+        if (argc > 3) threads = parse_count(argv[3]);
+    } catch (const exception&) {
+        cerr << "Usage: serialize [patterns] [threads] [file] (positive integers)\n";
+        return 1;
+    }
+    if (pattern_count == 0 || threads == 0) {
+        cerr << "patterns and threads must be at least 1\n";
+        return 1;
+    }
+    string filename = argc > 4 ? argv[4] : "patterns.pcre2";
+
+    vector<string> patterns = generate_patterns(pattern_count, 42);
+    cout << "\n=== Testing BULK COMPILATION (" << patterns.size() << " generated patterns) ===\n";
+    cout << "Examples:";
+    for (size_t i = 0; i < min<size_t>(3, patterns.size()); ++i) cout << "   " << patterns[i];
+    cout << "\n";
+    print_results_header();
+
+    for (size_t thread_count : {size_t(1), threads}) {
+        test_std_regex_bulk_compile(patterns, thread_count);
+        test_boost_regex_bulk_compile(patterns, thread_count);
+        test_pcre_bulk_compile(patterns, thread_count);
+        test_re2_bulk_compile(patterns, thread_count);
+        if (threads == 1) break;
+    }
+
+    cout << "\n=== Testing PCRE2 SERIALIZED PATTERNS ===\n";
+    print_results_header();
+    return test_pcre_serialize(patterns, filename) ? 0 : 1;
+}
+
+// Память скомпилированных шаблонов и бюджет DFA у RE2
+
+size_t current_rss_bytes() {
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return counters.WorkingSetSize;
+    }
+    return 0;
+#elif defined(__linux__)
+    ifstream statm("/proc/self/statm");
+    size_t total_pages = 0;
+    size_t resident_pages = 0;
+    statm >> total_pages >> resident_pages;
+    return resident_pages * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#else
+    return 0;
+#endif
+}
+
+const size_t footprint_copies = 1000;
+
+struct Footprint {
+    long long heap_bytes;
+    long long rss_bytes;
+    bool ok;
+};
+
+// Память на один объект: компилируем footprint_copies копий и держим их живыми до замера.
+// heap - живые байты, выделенные через operator new; rss - прирост памяти процесса (грубее: страницы, повторное использование кучи).
+// compile возвращает пустой указатель, если шаблон не скомпилировался
+template <typename Compile>
+Footprint footprint_per_pattern(Compile compile) {
+    vector<decltype(compile())> objects;
+    objects.reserve(footprint_copies);
+    AllocationScope scope;
+    long long heap_before = allocation_counters.live_bytes;
+    size_t rss_before = current_rss_bytes();
+    for (size_t i = 0; i < footprint_copies; ++i) {
+        objects.push_back(compile());
+    }
+    long long heap_after = allocation_counters.live_bytes;
+    size_t rss_after = current_rss_bytes();
+    long long copies = static_cast<long long>(footprint_copies);
+    return {(heap_after - heap_before) / copies, (static_cast<long long>(rss_after) - static_cast<long long>(rss_before)) / copies,
+            objects.front() != nullptr};
+}
+
+void print_footprint_header() {
+    cout << "| Pattern Name                   | RE2 prog | RE2 rprog | RE2 heap | PCRE bytes | PCRE JIT | std heap | boost heap | std RSS | boost RSS |\n";
+    cout << "|--------------------------------|----------|-----------|----------|------------|----------|----------|------------|---------|-----------|\n";
+}
+
+// RE2 prog/rprog - размер прямой и обратной программы в инструкциях (ProgramSize/ReverseProgramSize),
+// PCRE bytes/JIT - PCRE2_INFO_SIZE и PCRE2_INFO_JITSIZE, остальные столбцы - байт на шаблон.
+// Если движок не компилирует шаблон, его столбцы выводятся как "-"
+void test_pattern_footprint(const string& pattern_name, const string& pattern) {
+    int re2_program = -1;
+    int re2_reverse = -1;
+    {
+        RE2::Options options;
+        options.set_log_errors(false);
+        RE2 re(pattern, options);
+        if (re.ok()) {
+            re2_program = re.ProgramSize();
+            re2_reverse = re.ReverseProgramSize();
+        }
+    }
+
+    size_t pcre_bytes = 0;
+    size_t pcre_jit_bytes = 0;
+    bool pcre_ok = false;
+    {
+        PcreCodePtr re = compile_pcre_pattern(pattern, pcre_jit_available());
+        pcre_ok = static_cast<bool>(re);
+        if (re) {
+            pcre2_pattern_info(re.get(), PCRE2_INFO_SIZE, &pcre_bytes);
+            pcre2_pattern_info(re.get(), PCRE2_INFO_JITSIZE, &pcre_jit_bytes);
+        }
+    }
+
+    Footprint std_footprint = footprint_per_pattern([&] {
+        try {
+            return make_unique<regex>(pattern);
+        } catch (const exception&) {
+            return unique_ptr<regex>();
+        }
+    });
+    Footprint boost_footprint = footprint_per_pattern([&] {
+        try {
+            return make_unique<boost::regex>(pattern);
+        } catch (const exception&) {
+            return unique_ptr<boost::regex>();
+        }
+    });
+    Footprint re2_footprint = footprint_per_pattern([&] {
+        RE2::Options options;
+        options.set_log_errors(false);
+        auto re = make_unique<RE2>(pattern, options);
+        return re->ok() ? move(re) : unique_ptr<RE2>();
+    });
+
+    auto cell = [](bool ok, long long value) { return ok ? to_string(value) : string("-"); };
+
+    printf("| %-30s | %8s | %9s | %8s | %10s | %8s | %8s | %10s | %7s | %9s |\n",
+           pattern_name.c_str(),
+           cell(re2_program >= 0, re2_program).c_str(),
+           cell(re2_reverse >= 0, re2_reverse).c_str(),
+           cell(re2_footprint.ok, re2_footprint.heap_bytes).c_str(),
+           cell(pcre_ok, pcre_bytes).c_str(),
+           cell(pcre_ok, pcre_jit_bytes).c_str(),
+           cell(std_footprint.ok, std_footprint.heap_bytes).c_str(),
+           cell(boost_footprint.ok, boost_footprint.heap_bytes).c_str(),
+           cell(std_footprint.ok, std_footprint.rss_bytes).c_str(),
+           cell(boost_footprint.ok, boost_footprint.rss_bytes).c_str());
+}
+
+void run_footprint_report(const vector<pair<string, string>>& patterns) {
+    print_footprint_header();
+    for (const auto& [name, pattern] : patterns) {
+        test_pattern_footprint(name, pattern);
+    }
+}
+
+const vector<int64_t> re2_max_mem_budgets = {64 << 10, 256 << 10, 1 << 20, 2 << 20, 8 << 20, 64 << 20};
+
+void print_max_mem_header() {
+    cout << "| Pattern Name                   |  max_mem | RE2 prog |     MB/s | Search RSS Δ | Matches |\n";
+    cout << "|--------------------------------|----------|----------|----------|--------------|---------|\n";
+}
+
+// При исчерпании max_mem RE2 не сообщает об ошибке, а переходит с DFA на NFA - это видно по падению МБ/с
+void test_re2_max_mem(const string& text, const string& pattern_name, const string& pattern, int64_t max_mem) {
+    RE2::Options options;
+    options.set_max_mem(max_mem);
+    options.set_log_errors(false);
+    RE2 re(pattern, options);
+    if (!re.ok()) {
+        printf("| %-30s | %8s | %-46s |\n", pattern_name.c_str(), format_bytes(max_mem).c_str(), re.error().c_str());
+        return;
+    }
+
+    size_t rss_before = current_rss_bytes();
+    auto start = high_resolution_clock::now();
+    size_t matches = re2_for_each_match(re, text, 1, [](const string_view*, size_t) {});
+    auto end = high_resolution_clock::now();
+    long long rss_delta = static_cast<long long>(current_rss_bytes()) - static_cast<long long>(rss_before);
+
+    auto duration = duration_cast<microseconds>(end - start);
+    all_results.push_back({"max_mem", "RE2", pattern_name + " @" + format_bytes(max_mem), duration.count(), static_cast<int>(matches)});
+    printf("| %-30s | %8s | %8d | %8.1f | %12lld | %7zu |\n",
+           pattern_name.c_str(),
+           format_bytes(max_mem).c_str(),
+           re.ProgramSize(),
+           text.size() / 1e6 / max(duration.count() / 1e6, 1e-6),
+           rss_delta,
+           matches);
+}
+
+// Режим "memory": MyProject memory
+int run_memory_mode() {
+    cout << "\n=== Testing COMPILED PATTERN FOOTPRINT ===\n";
+    cout << "Word patterns:\n";
+    run_footprint_report(word_patterns);
+    cout << "\nWar and Peace patterns:\n";
+    run_footprint_report(war_and_peace_patterns);
+    cout << "\nRussian War and Peace patterns:\n";
+    run_footprint_report(war_and_peace_russian_patterns);
+
+    const vector<tuple<string, string, const vector<pair<string, string>>*>> texts = {
+        {"search.txt", "English text", &war_and_peace_patterns},
+        {"search_russian.txt", "Russian text", &war_and_peace_russian_patterns}
+    };
+    cout << "\n=== Testing RE2 max_mem BUDGET ===\n";
+    for (const auto& [filename, title, patterns] : texts) {
+        string text = read_file_to_string(filename);
+        if (text.empty()) continue;
+
+        cout << "\n" << title << ":\n";
+        print_max_mem_header();
+        for (const auto& [name, pattern] : *patterns) {
+            for (int64_t max_mem : re2_max_mem_budgets) {
+                test_re2_max_mem(text, name, pattern, max_mem);
+            }
+        }
+    }
+    return 0;
+}
+
+// Режимы кэша и размера страниц для буферов с данными
+
+// Привязка текущего потока к одному ядру, чтобы замеры не переезжали между кэшами разных ядер
+bool pin_to_cpu(int cpu) {
+#if defined(_WIN32)
+    return SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << cpu) != 0;
+#elif defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+    (void)cpu;
+    return false;
+#endif
+}
+
+enum class PageMode { Regular, Huge };
+
+// Копия набора данных в отдельно выделенной памяти с заданным размером страниц.
+// На Linux для Huge сначала пробуется MAP_HUGETLB (нужен пул /proc/sys/vm/nr_hugepages), затем прозрачные
+// huge pages через madvise(MADV_HUGEPAGE); для Regular THP явно отключается. На Windows используются
+// large pages (нужна привилегия SeLockMemoryPrivilege). page_kind() сообщает, что удалось получить:
+// для THP успешный madvise ничего не гарантирует, поэтому после заполнения буфера по AnonHugePages
+// в /proc/self/smaps проверяется, сколько его действительно легло на huge pages
+class PageBuffer {
+public:
+    PageBuffer(string_view data, PageMode mode) : size_(data.size()) {
+        allocate(mode);
+        memcpy(data_, data.data(), size_);
+#if defined(__linux__)
+        if (kind_ == "THP requested") {
+            // Область mmap шире буфера (выравнивание по 2 МБ), поэтому счётчик ограничивается его размером
+            size_t huge_bytes = min(anon_huge_bytes(data_), size_);
+            if (huge_bytes > 0) {
+                kind_ = "THP, " + format_bytes(huge_bytes) + " of " + format_bytes(size_) + " on huge pages";
+            } else {
+                kind_ += ", none mapped";
+            }
+        }
+#endif
+    }
+
+    ~PageBuffer() {
+#if defined(_WIN32)
+        VirtualFree(base_, 0, MEM_RELEASE);
+#elif defined(__linux__)
+        munmap(base_, mapped_);
+#else
+        delete[] base_;
+#endif
+    }
+
+    PageBuffer(const PageBuffer&) = delete;
+    PageBuffer& operator=(const PageBuffer&) = delete;
+
+    string_view view() const { return string_view(data_, size_); }
+    const string& page_kind() const { return kind_; }
+
+private:
+    void allocate(PageMode mode) {
+#if defined(_WIN32)
+        size_t large_page = GetLargePageMinimum();
+        if (mode == PageMode::Huge && large_page > 0) {
+            mapped_ = max((size_ + large_page - 1) / large_page * large_page, large_page);
+            base_ = static_cast<char*>(VirtualAlloc(nullptr, mapped_, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE));
+            if (base_) kind_ = "large pages";
+        }
+        if (!base_) {
+            mapped_ = max<size_t>(size_, 1);
+            base_ = static_cast<char*>(VirtualAlloc(nullptr, mapped_, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+        }
+        if (!base_) throw bad_alloc();
+        data_ = base_;
+#elif defined(__linux__)
+        const size_t huge_page = 2 << 20;
+        size_t rounded = max((size_ + huge_page - 1) / huge_page * huge_page, huge_page);
+        void* memory = MAP_FAILED;
+        if (mode == PageMode::Huge) {
+            memory = mmap(nullptr, rounded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (memory != MAP_FAILED) {
+                mapped_ = rounded;
+                kind_ = "hugetlb";
+            }
+        }
+        if (memory == MAP_FAILED) {
+            // Запас в одну huge page, чтобы выровнять начало данных по 2 МБ: иначе THP не покроет края
+            mapped_ = rounded + huge_page;
+            memory = mmap(nullptr, mapped_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (memory == MAP_FAILED) throw bad_alloc();
+        }
+        base_ = static_cast<char*>(memory);
+        data_ = base_;
+        if (kind_ != "hugetlb") {
+            data_ = reinterpret_cast<char*>((reinterpret_cast<uintptr_t>(base_) + huge_page - 1) & ~uintptr_t(huge_page - 1));
+            if (mode == PageMode::Huge && madvise(data_, rounded, MADV_HUGEPAGE) == 0) kind_ = "THP requested";
+            if (mode == PageMode::Regular) madvise(base_, mapped_, MADV_NOHUGEPAGE);
+        }
+#else
+        (void)mode;
+        base_ = new char[max<size_t>(size_, 1)];
+        data_ = base_;
+#endif
+    }
+
+    char* base_ = nullptr;
+    char* data_ = nullptr;
+    size_t size_ = 0;
+    size_t mapped_ = 0;
+    string kind_ = "4K";
+
+#if defined(__linux__)
+    // AnonHugePages области памяти, в которую попадает address
+    static size_t anon_huge_bytes(const void* address) {
+        ifstream smaps("/proc/self/smaps");
+        uintptr_t target = reinterpret_cast<uintptr_t>(address);
+        bool inside = false;
+        string line;
+        while (getline(smaps, line)) {
+            unsigned long start, end;
+            if (sscanf(line.c_str(), "%lx-%lx ", &start, &end) == 2 && line.find(' ') > line.find('-')) {
+                inside = start <= target && target < end;
+            } else if (inside && line.compare(0, 14, "AnonHugePages:") == 0) {
+                return stoull(line.substr(14)) * 1024;
+            }
+        }
+        return 0;
+    }
+#endif
+};
+
+size_t last_level_cache_bytes() {
+#if defined(__linux__) && defined(_SC_LEVEL3_CACHE_SIZE)
+    long l3 = sysconf(_SC_LEVEL3_CACHE_SIZE);
+    if (l3 > 0) return l3;
+    long l2 = sysconf(_SC_LEVEL2_CACHE_SIZE);
+    if (l2 > 0) return l2;
+#endif
+    return 32 << 20;
+}
+
+// Буфер вытеснения в 4 раза больше LLC; ограничен 512 МБ, так как виртуальные машины порой сообщают огромный L3
+size_t eviction_buffer_bytes() {
+    return min<size_t>(max<size_t>(4 * last_level_cache_bytes(), 64 << 20), 512 << 20);
+}
+
+// Вытесняет данные из LLC (и заодно из TLB) записью в буфер, в несколько раз больший кэша
+void evict_caches() {
+    static vector<char> sweep(eviction_buffer_bytes());
+    volatile char* bytes = sweep.data();
+    for (size_t i = 0; i < sweep.size(); i += 64) {
+        bytes[i] = bytes[i] + 1;
+    }
+}
+
+struct CacheMode {
+    string name;
+    PageMode pages;
+    bool cold;
+};
+
+const vector<CacheMode> cache_modes = {
+    {"warm", PageMode::Regular, false},
+    {"cold", PageMode::Regular, true},
+    {"huge", PageMode::Huge, false},
+    {"huge+cold", PageMode::Huge, true}
+};
+
+const size_t cache_mode_runs = 5;
+
+// Для каждого режима берется медиана из cache_mode_runs проходов. В холодном режиме перед каждым проходом
+// кэш вытесняется, а затем шаблон прогревается на первых 4 КБ данных: холодными остаются данные, но не автомат
+template <typename Scan>
+void measure_cache_modes(const string& library, const string& pattern_name, const PageBuffer& regular, const PageBuffer& huge, Scan scan) {
+    for (const auto& mode : cache_modes) {
+        string_view view = (mode.pages == PageMode::Huge ? huge : regular).view();
+        if (!mode.cold) scan(view);
+
+        vector<long long> times;
+        size_t matches = 0;
+        for (size_t run = 0; run < cache_mode_runs; ++run) {
+            if (mode.cold) {
+                evict_caches();
+                scan(dataset_prefix(view, 4096));
+            }
+            auto start = high_resolution_clock::now();
+            matches = scan(view);
+            auto end = high_resolution_clock::now();
+            times.push_back(duration_cast<microseconds>(end - start).count());
+        }
+        sort(times.begin(), times.end());
+
+        TestResult result{mode.name, library, pattern_name, times[times.size() / 2], static_cast<int>(matches)};
+        all_results.push_back(result);
+    }
+}
+
+// Функции для замеров в режимах кэша
+void test_std_regex_cache_modes(const PageBuffer& regular, const PageBuffer& huge, const string& pattern_name, const string& pattern, bool per_line) {
+    try {
+        regex re(pattern);
+        measure_cache_modes("std::regex", pattern_name, regular, huge, [&](string_view view) {
+            if (per_line) {
+                StdLineMatcher matcher{&re};
+                return count_line_matches(view, matcher);
+            }
+            return std_regex_for_each_match(re, view, 1, [](const string_view*, size_t) {});
+        });
+    } catch (const exception& e) {
+        cerr << "std::regex cache mode error with pattern '" << pattern << "': " << e.what() << endl;
+    }
+}
+
+void test_boost_regex_cache_modes(const PageBuffer& regular, const PageBuffer& huge, const string& pattern_name, const string& pattern, bool per_line) {
+    try {
+        boost::regex re(pattern);
+        measure_cache_modes("boost::regex", pattern_name, regular, huge, [&](string_view view) {
+            if (per_line) {
+                BoostLineMatcher matcher{&re};
+                return count_line_matches(view, matcher);
+            }
+            return boost_regex_for_each_match(re, view, 1, [](const string_view*, size_t) {});
+        });
+    } catch (const exception& e) {
+        cerr << "boost::regex cache mode error with pattern '" << pattern << "': " << e.what() << endl;
+    }
+}
+
+void test_pcre_cache_modes(const PageBuffer& regular, const PageBuffer& huge, const string& pattern_name, const string& pattern, bool per_line) {
+    try {
+        string error;
+        PcreCodePtr re = compile_pcre_pattern(pattern, false, &error);
+        if (!re) {
+            cerr << "PCRE compilation failed for pattern '" << pattern << "': " << error << endl;
+            return;
+        }
+
+        PcreLineMatcher matcher(re.get());
+        pcre2_match_data* match_data = pcre2_match_data_create(1, nullptr);
+        measure_cache_modes("PCRE", pattern_name, regular, huge, [&](string_view view) {
+            if (per_line) {
+                return count_line_matches(view, matcher);
+            }
+            return pcre_for_each_match(re.get(), match_data, view, [](const string_view*, size_t) {});
+        });
+
+        pcre2_match_data_free(match_data);
+    } catch (const exception& e) {
+        cerr << "PCRE cache mode error with pattern '" << pattern << "': " << e.what() << endl;
+    }
+}
+
+void test_re2_cache_modes(const PageBuffer& regular, const PageBuffer& huge, const string& pattern_name, const string& pattern, bool per_line) {
+    try {
+        RE2 re(pattern);
+        if (!re.ok()) {
+            cerr << "RE2 compilation failed for pattern '" << pattern << "': " << re.error() << endl;
+            return;
+        }
+
+        measure_cache_modes("RE2", pattern_name, regular, huge, [&](string_view view) {
+            if (per_line) {
+                Re2LineMatcher matcher{&re};
+                return count_line_matches(view, matcher);
+            }
+            return re2_for_each_match(re, view, 1, [](const string_view*, size_t) {});
+        });
+    } catch (const exception& e) {
+        cerr << "RE2 cache mode error with pattern '" << pattern << "': " << e.what() << endl;
+    }
+}
+
+// Таблица пропускной способности (МБ/с по медиане) с отдельной колонкой на каждый режим
+void print_cache_mode_table(const vector<pair<string, string>>& patterns, size_t bytes) {
+    const vector<string> libraries = {"std::regex", "boost::regex", "PCRE", "RE2"};
+    cout << "\n| Library      | Pattern Name                   |";
+    for (const auto& mode : cache_modes) printf(" %9s |", mode.name.c_str());
+    cout << " Cold/Warm | Matches |\n";
+    cout << "|--------------|--------------------------------|";
+    for (size_t i = 0; i < cache_modes.size(); ++i) cout << "-----------|";
+    cout << "-----------|---------|\n";
+
+    auto mbps = [&](const TestResult* result) {
+        return bytes / 1e6 / (max<long long>(result->time_us, 1) / 1e6);
+    };
+    // Режим, который не выполнился для движка, печатается как "-"
+    for (const auto& [name, pattern] : patterns) {
+        for (const auto& library : libraries) {
+            const TestResult* warm = find_result(cache_modes[0].name, library, name);
+            const TestResult* cold = find_result("cold", library, name);
+            const TestResult* reference = nullptr;
+            bool agree = true;
+            for (const auto& mode : cache_modes) {
+                const TestResult* result = find_result(mode.name, library, name);
+                if (!result) continue;
+                if (!reference) reference = result;
+                agree = agree && result->matches == reference->matches;
+            }
+            if (!reference) continue;
+
+            printf("| %-12s | %-30s |", library.c_str(), name.c_str());
+            for (const auto& mode : cache_modes) {
+                const TestResult* result = find_result(mode.name, library, name);
+                if (result) {
+                    printf(" %9.1f |", mbps(result));
+                } else {
+                    printf(" %9s |", "-");
+                }
+            }
+            if (warm && cold) {
+                printf(" %8.2fx |", mbps(cold) / mbps(warm));
+            } else {
+                printf(" %9s |", "-");
+            }
+            printf(" %7d |%s\n", reference->matches, agree ? "" : " COUNT MISMATCH");
+        }
+    }
+}
+
+int run_cache_mode(int argc, char* argv[]) {
+    int cpu = 0;
+    try {
+        if (argc > 2) cpu = static_cast<int>(parse_count(argv[2]));
+    } catch (const exception&) {
+        cerr << "Usage: cache [cpu]\n";
+        return 1;
+    }
+    if (pin_to_cpu(cpu)) {
+        cout << "Pinned to CPU " << cpu << "\n";
+    } else {
+        cout << "CPU pinning unavailable, running unpinned\n";
+    }
+    cout << "Last-level cache: " << format_bytes(last_level_cache_bytes()) << ", eviction buffer: "
+         << format_bytes(eviction_buffer_bytes()) << ", " << cache_mode_runs << " runs per mode (median)\n";
+
+    // Слова сопоставляются построчно с якорными шаблонами, текст "Войны и мира" просматривается целиком
+    const vector<tuple<string, const vector<pair<string, string>>*, bool>> datasets = {
+        {"match.txt", &word_patterns, true},
+        {"search.txt", &war_and_peace_patterns, false}
+    };
+    for (const auto& [filename, patterns, per_line] : datasets) {
+        string data = read_dataset_text(filename);
+        if (data.empty()) {
+            cerr << "Cannot load " << filename << " or its parts\n";
+            continue;
+        }
+
+        PageBuffer regular(data, PageMode::Regular);
+        PageBuffer huge(data, PageMode::Huge);
+        data.clear();
+        data.shrink_to_fit();
+
+        cout << "\n=== Testing CACHE MODES on " << filename << " (" << format_bytes(regular.view().size())
+             << ", huge buffer: " << huge.page_kind() << ") ===\n";
+        for (const auto& [name, pattern] : *patterns) {
+            cout << "Testing pattern: " << name << "\n";
+            test_std_regex_cache_modes(regular, huge, name, pattern, per_line);
+            test_boost_regex_cache_modes(regular, huge, name, pattern, per_line);
+            test_pcre_cache_modes(regular, huge, name, pattern, per_line);
+            test_re2_cache_modes(regular, huge, name, pattern, per_line);
+        }
+        print_cache_mode_table(*patterns, regular.view().size());
+    }
+    return 0;
+}
+
+// Сервисный режим: демон на Unix-сокете (epoll + пул обработчиков) и клиент, дающий нагрузку с заданным QPS.
+// Протокол - кадры с 32-битной длиной в начале, числа в порядке байт хоста (сокет локальный):
+//   запрос: id u64, engine u8, kind u8 (0 - номер шаблона, 1 - текст шаблона), pattern_id u32 | длина u32 + текст,
+//           count u32, затем count раз: длина u32 + данные
+//   ответ:  id u64, status i32; при status == 0: count u32, затем на каждый элемент: matches u32 + matches × (begin u32, end u32);
+//           иначе: длина u32 + текст ошибки
+
+enum class ServiceEngine : uint8_t { Std, Boost, Pcre, Re2 };
+
+const vector<pair<string, ServiceEngine>> service_engines = {
+    {"std", ServiceEngine::Std},
+    {"boost", ServiceEngine::Boost},
+    {"pcre", ServiceEngine::Pcre},
+    {"re2", ServiceEngine::Re2}
+};
+
+const char* service_engine_library(ServiceEngine engine) {
+    switch (engine) {
+        case ServiceEngine::Std: return "std::regex";
+        case ServiceEngine::Boost: return "boost::regex";
+        case ServiceEngine::Pcre: return "PCRE";
+        default: return "RE2";
+    }
+}
+
+const string default_service_socket = "/tmp/regex_benchmark.sock";
+const uint32_t service_max_frame = 64 << 20;
+// Пока у соединения столько неотправленных ответов или необработанных запросов, демон его не читает:
+// клиент, который не забирает ответы, упирается в буфер сокета, а не раздувает память сервера
+const size_t service_max_output = 16 << 20;
+const size_t service_max_queued_jobs = 1024;
+// Обработчиков у демона и соединений у клиента (у клиента по два потока на соединение)
+const size_t service_max_threads = 1024;
+const size_t service_pattern_cache_capacity = 4096;
+
+// Шаблоны, доступные по номеру: сначала шаблоны слов, затем "Войны и мира", затем русские
+vector<pair<string, string>> service_pattern_catalogue() {
+    vector<pair<string, string>> patterns = word_patterns;
+    patterns.insert(patterns.end(), war_and_peace_patterns.begin(), war_and_peace_patterns.end());
+    patterns.insert(patterns.end(), war_and_peace_russian_patterns.begin(), war_and_peace_russian_patterns.end());
+    return patterns;
+}
+
+template <typename T>
+void put_value(string& out, T value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+// Чтение полей кадра с проверкой границ: при выходе за конец ok сбрасывается, а поля читаются как нули
+struct FrameReader {
+    string_view data;
+    size_t pos = 0;
+    bool ok = true;
+
+    template <typename T>
+    T get() {
+        T value{};
+        if (data.size() - pos < sizeof(T)) {
+            ok = false;
+            return value;
+        }
+        memcpy(&value, data.data() + pos, sizeof(T));
+        pos += sizeof(T);
+        return value;
+    }
+
+    string_view bytes(size_t count) {
+        if (data.size() - pos < count) {
+            ok = false;
+            return {};
+        }
+        string_view result = data.substr(pos, count);
+        pos += count;
+        return result;
+    }
+};
+
+struct ServicePattern {
+    string error;
+    unique_ptr<regex> std_re;
+    unique_ptr<boost::regex> boost_re;
+    PcreCodePtr pcre_re{nullptr, pcre2_code_free};
+    unique_ptr<RE2> re2_re;
+};
+
+shared_ptr<const ServicePattern> compile_service_pattern(ServiceEngine engine, const string& pattern) {
+    auto compiled = make_shared<ServicePattern>();
+    try {
+        switch (engine) {
+            case ServiceEngine::Std:
+                compiled->std_re = make_unique<regex>(pattern);
+                break;
+            case ServiceEngine::Boost:
+                compiled->boost_re = make_unique<boost::regex>(pattern);
+                break;
+            case ServiceEngine::Pcre: {
+                string error;
+                compiled->pcre_re = compile_pcre_pattern(pattern, false, &error);
+                if (!compiled->pcre_re) compiled->error = "PCRE compilation failed: " + error;
+                break;
+            }
+            case ServiceEngine::Re2:
+                compiled->re2_re = make_unique<RE2>(pattern, RE2::Quiet);
+                if (!compiled->re2_re->ok()) compiled->error = compiled->re2_re->error();
+                break;
+        }
+    } catch (const exception& e) {
+        compiled->error = e.what();
+    }
+    return compiled;
+}
+
+// Общий для всех обработчиков кэш скомпилированных шаблонов. Компиляция идет вне блокировки,
+// чтобы медленный шаблон не задерживал остальные запросы; при гонке остается первый результат.
+// Ошибки компиляции тоже кэшируются. Ключи приходят от клиентов (текст шаблона), поэтому кэш ограничен
+// service_pattern_cache_capacity записями и вытесняет давно не использованные (LRU); шаблон, который
+// еще выполняется, живет до конца запроса благодаря shared_ptr
+class PatternCache {
+public:
+    shared_ptr<const ServicePattern> get(ServiceEngine engine, const string& pattern) {
+        string key = char('0' + static_cast<int>(engine)) + pattern;
+        {
+            lock_guard<mutex> lock(mutex_);
+            auto it = index_.find(key);
+            if (it != index_.end()) {
+                order_.splice(order_.begin(), order_, it->second);
+                return it->second->second;
+            }
+        }
+        auto compiled = compile_service_pattern(engine, pattern);
+        lock_guard<mutex> lock(mutex_);
+        auto it = index_.find(key);
+        if (it != index_.end()) return it->second->second;
+        order_.emplace_front(key, compiled);
+        index_.emplace(move(key), order_.begin());
+        if (order_.size() > service_pattern_cache_capacity) {
+            index_.erase(order_.back().first);
+            order_.pop_back();
+            evictions_++;
+        }
+        return compiled;
+    }
+
+    size_t size() const {
+        lock_guard<mutex> lock(mutex_);
+        return order_.size();
+    }
+
+    size_t evictions() const {
+        lock_guard<mutex> lock(mutex_);
+        return evictions_;
+    }
+
+private:
+    using Entry = pair<string, shared_ptr<const ServicePattern>>;
+
+    mutable mutex mutex_;
+    list<Entry> order_;  // от недавно использованных к давно не использованным
+    unordered_map<string, list<Entry>::iterator> index_;
+    size_t evictions_ = 0;
+};
+
+template <typename OnMatch>
+size_t service_match(const ServicePattern& compiled, ServiceEngine engine, string_view payload, OnMatch&& on_match) {
+    switch (engine) {
+        case ServiceEngine::Std:
+            return std_regex_for_each_match(*compiled.std_re, payload, 1, on_match);
+        case ServiceEngine::Boost:
+            return boost_regex_for_each_match(*compiled.boost_re, payload, 1, on_match);
+        case ServiceEngine::Pcre: {
+            // match_data не разделяется между потоками, поэтому у каждого обработчика свой
+            thread_local unique_ptr<pcre2_match_data, decltype(&pcre2_match_data_free)> match_data(
+                pcre2_match_data_create(1, nullptr), pcre2_match_data_free);
+            return pcre_for_each_match(compiled.pcre_re.get(), match_data.get(), payload, on_match);
+        }
+        default:
+            return re2_for_each_match(*compiled.re2_re, payload, 1, on_match);
+    }
+}
+
+string service_error_response(uint64_t id, const string& message) {
+    string response;
+    put_value<uint32_t>(response, 0);
+    put_value<uint64_t>(response, id);
+    put_value<int32_t>(response, 1);
+    put_value<uint32_t>(response, message.size());
+    response += message;
+    uint32_t length = response.size() - sizeof(uint32_t);
+    memcpy(&response[0], &length, sizeof(length));
+    return response;
+}
+
+// Разбирает кадр запроса (без префикса длины) и возвращает готовый кадр ответа
+string handle_service_request(PatternCache& cache, const vector<pair<string, string>>& catalogue, string_view frame) {
+    FrameReader reader{frame};
+    uint64_t id = reader.get<uint64_t>();
+    uint8_t engine_code = reader.get<uint8_t>();
+    uint8_t kind = reader.get<uint8_t>();
+    uint32_t value = reader.get<uint32_t>();
+    if (!reader.ok) return service_error_response(id, "truncated request header");
+    if (engine_code >= service_engines.size()) return service_error_response(id, "unknown engine");
+    ServiceEngine engine = static_cast<ServiceEngine>(engine_code);
+
+    string pattern;
+    if (kind == 0) {
+        if (value >= catalogue.size()) return service_error_response(id, "unknown pattern id " + to_string(value));
+        pattern = catalogue[value].second;
+    } else if (kind == 1) {
+        pattern = string(reader.bytes(value));
+    } else {
+        return service_error_response(id, "unknown pattern kind " + to_string(kind));
+    }
+
+    uint32_t count = reader.get<uint32_t>();
+    if (!reader.ok) return service_error_response(id, "truncated request");
+
+    auto compiled = cache.get(engine, pattern);
+    if (!compiled->error.empty()) return service_error_response(id, compiled->error);
+
+    string response;
+    put_value<uint32_t>(response, 0);
+    put_value<uint64_t>(response, id);
+    put_value<int32_t>(response, 0);
+    put_value<uint32_t>(response, count);
+    for (uint32_t i = 0; i < count; ++i) {
+        string_view payload = reader.bytes(reader.get<uint32_t>());
+        if (!reader.ok) return service_error_response(id, "truncated payload " + to_string(i));
+
+        size_t count_pos = response.size();
+        put_value<uint32_t>(response, 0);
+        uint32_t matches = service_match(*compiled, engine, payload, [&](const string_view* groups, size_t) {
+            put_value<uint32_t>(response, groups[0].data() - payload.data());
+            put_value<uint32_t>(response, groups[0].data() - payload.data() + groups[0].size());
+        });
+        memcpy(&response[count_pos], &matches, sizeof(matches));
+    }
+    uint32_t length = response.size() - sizeof(uint32_t);
+    memcpy(&response[0], &length, sizeof(length));
+    return response;
+}
+
+#if defined(__linux__)
+
+// Очередь заданий для обработчиков. В отличие от BoundedQueue конвейера здесь обработчики блокируются
+// на условной переменной: демон большую часть времени простаивает, и опрос в цикле занимал бы ядра
+template <typename T>
+class BlockingQueue {
+public:
+    void push(T item) {
+        {
+            lock_guard<mutex> lock(mutex_);
+            items_.push_back(move(item));
+        }
+        ready_.notify_one();
+    }
+
+    // false, если очередь закрыта и пуста
+    bool pop(T& item) {
+        unique_lock<mutex> lock(mutex_);
+        ready_.wait(lock, [&] { return closed_ || !items_.empty(); });
+        if (items_.empty()) return false;
+        item = move(items_.front());
+        items_.pop_front();
+        return true;
+    }
+
+    void close() {
+        {
+            lock_guard<mutex> lock(mutex_);
+            closed_ = true;
+        }
+        ready_.notify_all();
+    }
+
+private:
+    mutex mutex_;
+    condition_variable ready_;
+    deque<T> items_;
+    bool closed_ = false;
+};
+
+volatile sig_atomic_t service_stop_requested = 0;
+
+void request_service_stop(int) {
+    service_stop_requested = 1;
+}
+
+// Демон: поток событий принимает соединения и собирает кадры, обработчики выполняют запросы
+// и складывают ответы в pending соединения, а поток событий отправляет их после сигнала через eventfd
+class ServiceDaemon {
+public:
+    ServiceDaemon(const string& socket_path, size_t workers) : socket_path_(socket_path), worker_count_(workers) {}
+
+    int run() {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (socket_path_.size() >= sizeof(address.sun_path)) {
+            cerr << "Socket path too long: " << socket_path_ << endl;
+            return 1;
+        }
+        strcpy(address.sun_path, socket_path_.c_str());
+        listen_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        unlink(socket_path_.c_str());
+        if (listen_fd_ < 0 || ::bind(listen_fd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 ||
+            listen(listen_fd_, SOMAXCONN) < 0) {
+            cerr << "Cannot listen on " << socket_path_ << ": " << strerror(errno) << endl;
+            if (listen_fd_ >= 0) close(listen_fd_);
+            return 1;
+        }
+
+        epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+        wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        watch(listen_fd_, EPOLLIN, EPOLL_CTL_ADD);
+        watch(wake_fd_, EPOLLIN, EPOLL_CTL_ADD);
+
+        struct sigaction action{};
+        action.sa_handler = request_service_stop;
+        sigaction(SIGINT, &action, nullptr);
+        sigaction(SIGTERM, &action, nullptr);
+
+        vector<thread> workers;
+        for (size_t i = 0; i < worker_count_; ++i) workers.emplace_back([this] { work(); });
+
+        cout << "Serving " << catalogue_.size() << " catalogue patterns on " << socket_path_ << " with "
+             << worker_count_ << " workers (Ctrl+C to stop)\n";
+
+        epoll_event events[64];
+        while (!service_stop_requested) {
+            int count = epoll_wait(epoll_fd_, events, 64, 200);
+            for (int i = 0; i < count; ++i) {
+                int fd = events[i].data.fd;
+                if (fd == listen_fd_) {
+                    accept_clients();
+                } else if (fd == wake_fd_) {
+                    flush_ready();
+                } else {
+                    auto it = connections_.find(fd);
+                    if (it == connections_.end()) continue;
+                    auto connection = it->second;
+                    if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR | EPOLLRDHUP)) read_client(connection);
+                    if (!connection->closed && (events[i].events & EPOLLOUT)) flush(connection);
+                }
+            }
+        }
+
+        jobs_.close();
+        for (auto& worker : workers) worker.join();
+        while (!connections_.empty()) close_client(connections_.begin()->second);
+        close(wake_fd_);
+        close(epoll_fd_);
+        close(listen_fd_);
+        unlink(socket_path_.c_str());
+
+        cout << "\nServed " << requests_served_.load() << " requests, " << cache_.size() << " compiled patterns cached ("
+             << cache_.evictions() << " evicted)\n";
+        return 0;
+    }
+
+private:
+    struct Connection {
+        int fd = -1;
+        bool closed = false;
+        bool want_write = false;
+        uint32_t events = EPOLLIN | EPOLLRDHUP;
+        atomic<size_t> queued_jobs{0};
+        string input;
+        string output;
+        size_t output_sent = 0;
+        mutex pending_mutex;
+        string pending;
+    };
+
+    struct Job {
+        shared_ptr<Connection> connection;
+        string frame;
+    };
+
+    void watch(int fd, uint32_t events, int operation) {
+        epoll_event event{};
+        event.events = events;
+        event.data.fd = fd;
+        epoll_ctl(epoll_fd_, operation, fd, &event);
+    }
+
+    // Подписка соединения: EPOLLIN снимается, пока ответы не разгребены, EPOLLOUT ставится, пока буфер сокета полон
+    void update_events(const shared_ptr<Connection>& connection) {
+        bool backlogged = connection->queued_jobs >= service_max_queued_jobs ||
+                          connection->output.size() - connection->output_sent >= service_max_output;
+        uint32_t events = uint32_t(EPOLLRDHUP) | (backlogged ? 0u : uint32_t(EPOLLIN)) |
+                          (connection->want_write ? uint32_t(EPOLLOUT) : 0u);
+        if (events != connection->events) {
+            connection->events = events;
+            watch(connection->fd, events, EPOLL_CTL_MOD);
+        }
+    }
+
+    void accept_clients() {
+        while (true) {
+            int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) return;
+            auto connection = make_shared<Connection>();
+            connection->fd = fd;
+            connections_[fd] = connection;
+            watch(fd, EPOLLIN | EPOLLRDHUP, EPOLL_CTL_ADD);
+        }
+    }
+
+    void close_client(const shared_ptr<Connection>& connection) {
+        epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, connection->fd, nullptr);
+        close(connection->fd);
+        connection->closed = true;
+        connections_.erase(connection->fd);
+    }
+
+    void read_client(const shared_ptr<Connection>& connection) {
+        char buffer[64 << 10];
+        while (true) {
+            ssize_t received = recv(connection->fd, buffer, sizeof(buffer), 0);
+            if (received > 0) {
+                connection->input.append(buffer, received);
+                continue;
+            }
+            if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+            if (received < 0 && errno == EINTR) continue;
+            close_client(connection);
+            return;
+        }
+
+        string& input = connection->input;
+        size_t pos = 0;
+        while (input.size() - pos >= sizeof(uint32_t)) {
+            uint32_t length;
+            memcpy(&length, input.data() + pos, sizeof(length));
+            if (length > service_max_frame) {
+                cerr << "Frame of " << length << " bytes exceeds limit, closing connection\n";
+                close_client(connection);
+                return;
+            }
+            if (input.size() - pos - sizeof(uint32_t) < length) break;
+            connection->queued_jobs++;
+            jobs_.push({connection, input.substr(pos + sizeof(uint32_t), length)});
+            pos += sizeof(uint32_t) + length;
+        }
+        input.erase(0, pos);
+        update_events(connection);
+    }
+
+    void flush(const shared_ptr<Connection>& connection) {
+        {
+            lock_guard<mutex> lock(connection->pending_mutex);
+            if (connection->output.empty()) {
+                connection->output.swap(connection->pending);
+            } else {
+                connection->output += connection->pending;
+                connection->pending.clear();
+            }
+        }
+
+        while (connection->output_sent < connection->output.size()) {
+            ssize_t sent = send(connection->fd, connection->output.data() + connection->output_sent,
+                                connection->output.size() - connection->output_sent, MSG_NOSIGNAL);
+            if (sent > 0) {
+                connection->output_sent += sent;
+            } else if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                connection->want_write = true;
+                update_events(connection);
+                return;
+            } else if (sent < 0 && errno == EINTR) {
+                continue;
+            } else {
+                close_client(connection);
+                return;
+            }
+        }
+
+        connection->output.clear();
+        connection->output_sent = 0;
+        connection->want_write = false;
+        update_events(connection);
+    }
+
+    void flush_ready() {
+        uint64_t signals;
+        while (read(wake_fd_, &signals, sizeof(signals)) > 0) {}
+
+        vector<shared_ptr<Connection>> ready;
+        {
+            lock_guard<mutex> lock(ready_mutex_);
+            ready.swap(ready_);
+        }
+        for (const auto& connection : ready) {
+            if (!connection->closed) flush(connection);
+        }
+    }
+
+    void work() {
+        Job job;
+        while (jobs_.pop(job)) {
+            string response = handle_service_request(cache_, catalogue_, job.frame);
+            requests_served_++;
+            {
+                lock_guard<mutex> lock(job.connection->pending_mutex);
+                job.connection->pending += response;
+            }
+            job.connection->queued_jobs--;
+            {
+                lock_guard<mutex> lock(ready_mutex_);
+                ready_.push_back(move(job.connection));
+            }
+            uint64_t signal = 1;
+            ssize_t written = write(wake_fd_, &signal, sizeof(signal));
+            (void)written;
         }
-        cout << "\n\n";
-    } catch (const exception& e) {
-        cerr << "RE2 extensions error: " << e.what() << endl;
     }
-}
 
-string get_filename_without_extension(const string& path) {
-    size_t last_slash = path.find_last_of("/\\");
-    size_t last_dot = path.find_last_of('.');
-    
-    if (last_dot != string::npos && (last_slash == string::npos || last_dot > last_slash)) {
-        return path.substr(last_slash == string::npos ? 0 : last_slash + 1, 
-                          last_dot - (last_slash == string::npos ? 0 : last_slash + 1));
+    string socket_path_;
+    size_t worker_count_;
+    int listen_fd_ = -1;
+    int epoll_fd_ = -1;
+    int wake_fd_ = -1;
+    unordered_map<int, shared_ptr<Connection>> connections_;
+    BlockingQueue<Job> jobs_;
+    mutex ready_mutex_;
+    vector<shared_ptr<Connection>> ready_;
+    PatternCache cache_;
+    const vector<pair<string, string>> catalogue_ = service_pattern_catalogue();
+    atomic<size_t> requests_served_{0};
+};
+
+int run_service_daemon(int argc, char* argv[]) {
+    string socket_path = argc > 2 ? argv[2] : default_service_socket;
+    size_t workers = max(1u, thread::hardware_concurrency());
+    try {
+        if (argc > 3) workers = parse_count(argv[3]);
+    } catch (const exception&) {
+        workers = 0;
     }
-    return path.substr(last_slash == string::npos ? 0 : last_slash + 1);
+    if (workers == 0 || workers > service_max_threads) {
+        cerr << "Usage: serve [socket] [workers] (workers from 1 to " << service_max_threads << ")\n";
+        return 1;
+    }
+    ServiceDaemon daemon(socket_path, workers);
+    return daemon.run();
 }
 
-// Шаблон для поиска файлов по имени без учета расширения
-const string filename_pattern = R"(^.*[\\/](file\d+)(?:\.[a-zA-Z0-9]+)?$)";
+// Клиент нагрузки
 
-// Функции для тестирования поиска файлов по имени
-void test_std_regex_find_files(const vector<string>& paths, const string& filename) {
-    try {
-        string pattern = R"(^.*[\\/]()" + filename + R"()(?:\.[a-zA-Z0-9]+)?$)";
-        regex re(pattern);
-        vector<string> found_files;
-        
-        auto start = high_resolution_clock::now();
-        for (const auto& path : paths) {
-            smatch match;
-            if (regex_search(path, match, re) && match.size() > 1) {
-                found_files.push_back(path);
-            }
+// Заготовка запроса: кадр с нулевым id, который подставляется при отправке
+struct ServiceRequestTemplate {
+    string frame;
+    size_t payload_bytes;
+};
+
+// Запросы чередуются между словами из match.txt (шаблоны слов) и строками search.txt (шаблоны "Войны и мира").
+// Каждый восьмой запрос передает текст шаблона вместо номера, чтобы проверить путь через кэш по тексту
+vector<ServiceRequestTemplate> build_service_requests(ServiceEngine engine, size_t batch, size_t pool_size) {
+    struct Source {
+        vector<string> lines;
+        size_t first_pattern;
+        const vector<pair<string, string>>* patterns;
+        size_t next_line = 0;
+    };
+    // Каждому источнику достается не больше pool_size запросов по batch строк, остальное не читается
+    const size_t max_lines = pool_size * batch;
+    vector<Source> sources;
+    sources.push_back({read_dataset_lines("match.txt", max_lines), 0, &word_patterns});
+    vector<string> search_lines;
+    for (auto& line : read_dataset_lines("search.txt", max_lines)) {
+        if (!line.empty()) search_lines.push_back(move(line));
+    }
+    sources.push_back({move(search_lines), word_patterns.size(), &war_and_peace_patterns});
+    sources.erase(remove_if(sources.begin(), sources.end(), [](const Source& source) { return source.lines.empty(); }), sources.end());
+
+    vector<ServiceRequestTemplate> requests;
+    if (sources.empty()) return requests;
+    for (size_t i = 0; i < pool_size; ++i) {
+        Source& source = sources[i % sources.size()];
+        size_t pattern_index = (i / sources.size()) % source.patterns->size();
+
+        ServiceRequestTemplate request{string(), 0};
+        string& frame = request.frame;
+        put_value<uint32_t>(frame, 0);
+        put_value<uint64_t>(frame, 0);
+        put_value<uint8_t>(frame, static_cast<uint8_t>(engine));
+        if (i % 8 == 7) {
+            const string& pattern = (*source.patterns)[pattern_index].second;
+            put_value<uint8_t>(frame, 1);
+            put_value<uint32_t>(frame, pattern.size());
+            frame += pattern;
+        } else {
+            put_value<uint8_t>(frame, 0);
+            put_value<uint32_t>(frame, source.first_pattern + pattern_index);
         }
-        auto end = high_resolution_clock::now();
-        
-        auto duration = duration_cast<microseconds>(end - start);
-        TestResult result{"find_file", "std::regex", "Find by name", duration.count(), static_cast<int>(found_files.size())};
-        all_results.push_back(result);
-        print_test_result(result);
-        
-        // Вывод первых 5 найденных файлов (если есть)
-        if (!found_files.empty()) {
-            cout << "std::regex found " << found_files.size() << " files. Examples:\n";
-            for (size_t i = 0; i < min(found_files.size(), size_t(5)); ++i) {
-                cout << "  " << found_files[i] << "\n";
-            }
-            if (found_files.size() > 5) cout << "  ...\n";
+        put_value<uint32_t>(frame, batch);
+        for (size_t j = 0; j < batch; ++j) {
+            const string& line = source.lines[source.next_line++ % source.lines.size()];
+            put_value<uint32_t>(frame, line.size());
+            frame += line;
+            request.payload_bytes += line.size();
         }
-        cout << "\n";
-    } catch (const exception& e) {
-        cerr << "std::regex find files error: " << e.what() << endl;
+        uint32_t length = frame.size() - sizeof(uint32_t);
+        memcpy(&frame[0], &length, sizeof(length));
+        requests.push_back(move(request));
     }
+    return requests;
 }
 
-void test_boost_regex_find_files(const vector<string>& paths, const string& filename) {
-    try {
-        string pattern = R"(^.*[\\/]()" + filename + R"()(?:\.[a-zA-Z0-9]+)?$)";
-        boost::regex re(pattern);
-        vector<string> found_files;
-        
-        auto start = high_resolution_clock::now();
-        for (const auto& path : paths) {
-            boost::smatch match;
-            if (boost::regex_search(path, match, re) && match.size() > 1) {
-                found_files.push_back(path);
-            }
+bool read_exact(int fd, char* data, size_t size) {
+    while (size > 0) {
+        ssize_t received = recv(fd, data, size, 0);
+        if (received > 0) {
+            data += received;
+            size -= received;
+        } else if (received < 0 && errno == EINTR) {
+            continue;
+        } else {
+            return false;
         }
-        auto end = high_resolution_clock::now();
-        
-        auto duration = duration_cast<microseconds>(end - start);
-        TestResult result{"find_file", "boost::regex", "Find by name", duration.count(), static_cast<int>(found_files.size())};
-        all_results.push_back(result);
-        print_test_result(result);
-        
-        if (!found_files.empty()) {
-            cout << "boost::regex found " << found_files.size() << " files. Examples:\n";
-            for (size_t i = 0; i < min(found_files.size(), size_t(5)); ++i) {
-                cout << "  " << found_files[i] << "\n";
-            }
-            if (found_files.size() > 5) cout << "  ...\n";
+    }
+    return true;
+}
+
+bool write_all(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t sent = send(fd, data, size, MSG_NOSIGNAL);
+        if (sent > 0) {
+            data += sent;
+            size -= sent;
+        } else if (sent < 0 && errno == EINTR) {
+            continue;
+        } else {
+            return false;
         }
-        cout << "\n";
-    } catch (const exception& e) {
-        cerr << "boost::regex find files error: " << e.what() << endl;
     }
+    return true;
 }
 
-void test_pcre_find_files(const vector<string>& paths, const string& filename) {
-    try {
-        string pattern = R"(^.*[\\/]()" + filename + R"()(?:\.[a-zA-Z0-9]+)?$)";
-        int errnum;
-        PCRE2_SIZE erroff;
-        pcre2_code* re = pcre2_compile(
-            (PCRE2_SPTR8)pattern.c_str(),
-            PCRE2_ZERO_TERMINATED,
-            0,
-            &errnum,
-            &erroff,
-            nullptr
-        );
-        
-        if (!re) {
-            PCRE2_UCHAR buffer[256];
-            pcre2_get_error_message(errnum, buffer, sizeof(buffer));
-            cerr << "PCRE compilation failed: " << buffer << endl;
-            return;
+int connect_service(const string& socket_path) {
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+    if (fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+struct ServiceLoadReport {
+    size_t sent = 0;
+    size_t completed = 0;
+    size_t errors = 0;
+    size_t matches = 0;
+    size_t payload_bytes = 0;
+    double seconds = 0;
+    vector<long long> latencies_us;
+    string first_error;
+};
+
+// Открытая модель нагрузки: запрос i уходит в момент start + i / qps независимо от ответов, а задержка
+// считается от этого запланированного момента. Так очередь на стороне сервера попадает в p99, а не прячется
+// за замедлившимся отправителем (coordinated omission). Соединение c отправляет запросы c, c + connections, ...,
+// поэтому его расписание сдвинуто на c / qps, и соединения не отправляют запросы одновременно
+ServiceLoadReport run_service_load(const string& socket_path, const vector<ServiceRequestTemplate>& requests,
+                                   double qps, double duration_seconds, size_t connections) {
+    ServiceLoadReport report;
+    const size_t per_connection = max<size_t>(1, static_cast<size_t>(qps * duration_seconds / connections));
+    const auto interval = nanoseconds(static_cast<long long>(1e9 * connections / qps));
+    const auto start = steady_clock::now() + milliseconds(50);
+    auto scheduled = [&](size_t c, uint64_t i) {
+        return start + interval * i + nanoseconds(static_cast<long long>(1e9 * c / qps));
+    };
+
+    vector<int> sockets;
+    for (size_t c = 0; c < connections; ++c) {
+        int fd = connect_service(socket_path);
+        if (fd < 0) {
+            cerr << "Cannot connect to " << socket_path << ": " << strerror(errno) << endl;
+            for (int open_fd : sockets) close(open_fd);
+            return report;
         }
-        
-        pcre2_match_data* match_data = pcre2_match_data_create_from_pattern(re, nullptr);
-        vector<string> found_files;
-        
-        auto start = high_resolution_clock::now();
-        for (const auto& path : paths) {
-            int rc = pcre2_match(
-                re,
-                (PCRE2_SPTR8)path.c_str(),
-                path.length(),
-                0,
-                0,
-                match_data,
-                nullptr
-            );
-            
-            if (rc > 1) {
-                PCRE2_SIZE* ovector = pcre2_get_ovector_pointer(match_data);
-                size_t start_pos = ovector[2];
-                size_t end_pos = ovector[3];
-                if (start_pos != PCRE2_UNSET && end_pos != PCRE2_UNSET) {
-                    found_files.push_back(path);
-                }
+        sockets.push_back(fd);
+    }
+
+    mutex report_mutex;
+    vector<thread> threads;
+    vector<size_t> sent(connections, 0);
+    steady_clock::time_point last_response = start;
+    atomic<size_t> finished_receivers{0};
+    for (size_t c = 0; c < connections; ++c) {
+        threads.emplace_back([&, c] {
+            string frame;
+            for (size_t i = 0; i < per_connection; ++i) {
+                this_thread::sleep_until(scheduled(c, i));
+                frame = requests[(i * connections + c) % requests.size()].frame;
+                uint64_t id = i;
+                memcpy(&frame[sizeof(uint32_t)], &id, sizeof(id));
+                if (!write_all(sockets[c], frame.data(), frame.size())) break;
+                sent[c]++;
             }
-        }
-        auto end_time = high_resolution_clock::now();
-        
-        auto duration = duration_cast<microseconds>(end_time - start);
-        TestResult result{"find_file", "PCRE", "Find by name", duration.count(), static_cast<int>(found_files.size())};
-        all_results.push_back(result);
-        print_test_result(result);
-        
-        if (!found_files.empty()) {
-            cout << "PCRE found " << found_files.size() << " files. Examples:\n";
-            for (size_t i = 0; i < min(found_files.size(), size_t(5)); ++i) {
-                cout << "  " << found_files[i] << "\n";
+        });
+        threads.emplace_back([&, c] {
+            vector<long long> latencies;
+            latencies.reserve(per_connection);
+            size_t errors = 0, matches = 0, payload_bytes = 0;
+            string first_error;
+            steady_clock::time_point last = start;
+            string response;
+            for (size_t received = 0; received < per_connection; ++received) {
+                uint32_t length;
+                if (!read_exact(sockets[c], reinterpret_cast<char*>(&length), sizeof(length))) break;
+                response.resize(length);
+                if (!read_exact(sockets[c], &response[0], length)) break;
+                last = steady_clock::now();
+
+                FrameReader reader{response};
+                uint64_t id = reader.get<uint64_t>();
+                int32_t status = reader.get<int32_t>();
+                latencies.push_back(duration_cast<microseconds>(last - scheduled(c, id)).count());
+                if (status != 0) {
+                    errors++;
+                    if (first_error.empty()) first_error = string(reader.bytes(reader.get<uint32_t>()));
+                    continue;
+                }
+                payload_bytes += requests[(id * connections + c) % requests.size()].payload_bytes;
+                uint32_t count = reader.get<uint32_t>();
+                for (uint32_t j = 0; j < count && reader.ok; ++j) {
+                    uint32_t payload_matches = reader.get<uint32_t>();
+                    matches += payload_matches;
+                    reader.bytes(payload_matches * 2 * sizeof(uint32_t));
+                }
             }
-            if (found_files.size() > 5) cout << "  ...\n";
-        }
-        cout << "\n";
-        
-        pcre2_match_data_free(match_data);
-        pcre2_code_free(re);
-    } catch (const exception& e) {
-        cerr << "PCRE find files error: " << e.what() << endl;
+
+            lock_guard<mutex> lock(report_mutex);
+            report.completed += latencies.size();
+            report.errors += errors;
+            report.matches += matches;
+            report.payload_bytes += payload_bytes;
+            report.latencies_us.insert(report.latencies_us.end(), latencies.begin(), latencies.end());
+            if (report.first_error.empty()) report.first_error = first_error;
+            last_response = max(last_response, last);
+            finished_receivers++;
+        });
     }
+
+    // Отправители завершаются сами; получателям дается 5 секунд на хвост ответов, затем сокеты закрываются
+    for (size_t c = 0; c < connections; ++c) threads[2 * c].join();
+    auto deadline = steady_clock::now() + seconds(5);
+    while (finished_receivers.load() < connections && steady_clock::now() < deadline) {
+        this_thread::sleep_for(milliseconds(10));
+    }
+    for (int fd : sockets) shutdown(fd, SHUT_RDWR);
+    for (size_t c = 0; c < connections; ++c) {
+        threads[2 * c + 1].join();
+        close(sockets[c]);
+    }
+
+    for (size_t count : sent) report.sent += count;
+    report.seconds = duration_cast<microseconds>(last_response - start).count() / 1e6;
+    sort(report.latencies_us.begin(), report.latencies_us.end());
+    return report;
 }
 
-void test_re2_find_files(const vector<string>& paths, const string& filename) {
+long long latency_percentile(const vector<long long>& sorted, double percentile) {
+    if (sorted.empty()) return 0;
+    return sorted[min(sorted.size() - 1, static_cast<size_t>(percentile / 100 * sorted.size()))];
+}
+
+void print_service_load_header() {
+    cout << "| Library      | Target QPS | Achieved QPS |   MB/s |  Errors |   Matches | p50 μs | p99 μs | p99.9 μs |  Max μs |\n";
+    cout << "|--------------|------------|--------------|--------|---------|-----------|--------|--------|----------|---------|\n";
+}
+
+void report_service_load(const string& library, double qps, const ServiceLoadReport& report) {
+    double seconds = max(report.seconds, 1e-6);
+    printf("| %-12s | %10.0f | %12.0f | %6.1f | %7zu | %9zu | %6lld | %6lld | %8lld | %7lld |\n",
+           library.c_str(),
+           qps,
+           report.completed / seconds,
+           report.payload_bytes / 1e6 / seconds,
+           report.errors,
+           report.matches,
+           latency_percentile(report.latencies_us, 50),
+           latency_percentile(report.latencies_us, 99),
+           latency_percentile(report.latencies_us, 99.9),
+           report.latencies_us.empty() ? 0LL : report.latencies_us.back());
+    if (report.completed < report.sent) {
+        cout << "  " << report.sent - report.completed << " of " << report.sent << " requests got no response\n";
+    }
+    if (!report.first_error.empty()) {
+        cout << "  first error: " << report.first_error << "\n";
+    }
+}
+
+int run_service_client(int argc, char* argv[]) {
+    string engine_name = argc > 2 ? argv[2] : "all";
+    size_t qps = 1000;
+    size_t seconds = 5;
+    size_t batch = 16;
+    size_t connections = 2;
     try {
-        string pattern = R"(^.*[\\/]()" + filename + R"()(?:\.[a-zA-Z0-9]+)?$)";
-        RE2 re(pattern);
-        if (!re.ok()) {
-            cerr << "RE2 compilation failed: " << re.error() << endl;
-            return;
-        }
-        
-        vector<string> found_files;
-        
-        auto start = high_resolution_clock::now();
-        for (const auto& path : paths) {
-            if (RE2::FullMatch(path, re)) {
-                found_files.push_back(path);
-            }
-        }
-        auto end_time = high_resolution_clock::now();
-        
-        auto duration = duration_cast<microseconds>(end_time - start);
-        TestResult result{"find_file", "RE2", "Find by name", duration.count(), static_cast<int>(found_files.size())};
-        all_results.push_back(result);
-        print_test_result(result);
-        
-        if (!found_files.empty()) {
-            cout << "RE2 found " << found_files.size() << " files. Examples:\n";
-            for (size_t i = 0; i < min(found_files.size(), size_t(5)); ++i) {
-                cout << "  " << found_files[i] << "\n";
-            }
-            if (found_files.size() > 5) cout << "  ...\n";
+        if (argc > 3) qps = parse_count(argv[3]);
+        if (argc > 4) seconds = parse_count(argv[4]);
+        if (argc > 5) batch = parse_count(argv[5]);
+        if (argc > 6) connections = parse_count(argv[6]);
+    } catch (const exception&) {
+        qps = 0;
+    }
+    string socket_path = argc > 7 ? argv[7] : default_service_socket;
+    if (qps == 0 || seconds == 0 || batch == 0 || connections == 0 || batch > 65536 ||
+        connections > service_max_threads) {
+        cerr << "Usage: client [engine|all] [qps] [seconds] [batch] [connections] [socket]\n"
+             << "(positive integers, batch up to 65536, connections up to " << service_max_threads << ")\n";
+        return 1;
+    }
+
+    vector<pair<string, ServiceEngine>> engines;
+    for (const auto& engine : service_engines) {
+        if (engine_name == "all" || engine_name == engine.first) engines.push_back(engine);
+    }
+    if (engines.empty()) {
+        cerr << "Unknown engine '" << engine_name << "' (expected std, boost, pcre, re2 or all)\n";
+        return 1;
+    }
+
+    cout << "\n=== Testing SERVICE LATENCY (" << socket_path << ", " << qps << " QPS for " << seconds << " s, batch "
+         << batch << ", " << connections << " connections) ===\n";
+    print_service_load_header();
+    for (const auto& [name, engine] : engines) {
+        vector<ServiceRequestTemplate> requests = build_service_requests(engine, batch, 256);
+        if (requests.empty()) {
+            cerr << "Cannot load match.txt or search.txt for replay\n";
+            return 1;
         }
-        cout << "\n";
-    } catch (const exception& e) {
-        cerr << "RE2 find files error: " << e.what() << endl;
+        ServiceLoadReport report = run_service_load(socket_path, requests, qps, seconds, connections);
+        if (report.sent == 0) return 1;
+        report_service_load(service_engine_library(engine), qps, report);
     }
+    return 0;
+}
+
+#else
+
+int run_service_daemon(int, char*[]) {
+    cerr << "Service mode requires Linux (epoll and Unix domain sockets)\n";
+    return 1;
 }
 
+int run_service_client(int, char*[]) {
+    cerr << "Service mode requires Linux (epoll and Unix domain sockets)\n";
+    return 1;
+}
+
+#endif
+
+int main(int argc, char* argv[]) {
+    if (argc > 1 && string(argv[1]) == "pipeline") {
+        return run_pipeline_mode(argc, argv);
+    }
+    if (argc > 1 && string(argv[1]) == "compressed") {
+        return run_compressed_mode();
+    }
+    if (argc > 1 && string(argv[1]) == "generate") {
+        return run_generate_mode(argc, argv);
+    }
+    if (argc > 1 && string(argv[1]) == "sweep") {
+        return run_sweep_mode(argc, argv);
+    }
+    if (argc > 1 && string(argv[1]) == "serialize") {
+        return run_serialize_mode(argc, argv);
+    }
+    if (argc > 1 && string(argv[1]) == "memory") {
+        return run_memory_mode();
+    }
+    if (argc > 1 && string(argv[1]) == "cache") {
+        return run_cache_mode(argc, argv);
+    }
+    if (argc > 1 && string(argv[1]) == "serve") {
+        return run_service_daemon(argc, argv);
+    }
+    if (argc > 1 && string(argv[1]) == "client") {
+        return run_service_client(argc, argv);
+    }
 
-int main() {
     // Тестирование компиляции регулярных выражений
     cout << "\n=== Testing REGEX COMPILATION ===\n";
     print_results_header();
@@ -789,20 +4914,16 @@ int main() {
         test_re2_compile(name, pattern);
     }
 
+    cout << "\n=== Testing COMPILED PATTERN FOOTPRINT ===\n";
+    run_footprint_report(word_patterns);
+
     // Тестирование match на отдельных словах
-    ifstream words_file("match.txt");
-    if (!words_file) {
+    vector<string> words = read_dataset_lines("match.txt");
+    if (words.empty()) {
         cerr << "Cannot open match.txt\n";
         return 1;
     }
 
-    vector<string> words;
-    string word;
-    while (getline(words_file, word)) {
-        words.push_back(word);
-    }
-    words_file.close();
-
     cout << "\nLoaded " << words.size() << " words for match testing\n";
     cout << "Warming up cache... ";
     warmup_cache(words);
@@ -821,6 +4942,23 @@ int main() {
         test_re2_match(words, name, pattern);
     }
 
+    cout << "\n=== Testing BATCHED MATCH (" << word_block_bytes / 1024 << " KB newline-delimited blocks) ===\n";
+    vector<WordBlock> word_blocks = pack_word_blocks(words, word_block_bytes);
+    cout << "Packed " << words.size() << " words into " << word_blocks.size() << " blocks\n";
+    print_results_header();
+
+    for (const auto& [name, pattern] : word_patterns) {
+        cout << "\nTesting pattern: " << name << " (" << to_line_pattern(pattern) << ")\n";
+
+        test_std_regex_batched_match(word_blocks, name, pattern);
+        test_boost_regex_batched_match(word_blocks, name, pattern);
+        test_pcre_batched_match(word_blocks, name, pattern);
+        test_re2_batched_match(word_blocks, name, pattern);
+    }
+    print_batched_gain(word_patterns);
+    word_blocks.clear();
+    word_blocks.shrink_to_fit();
+
     // Тестирование search в "Войне и мире"
     cout << "\n\n=== Testing SEARCH operations ===\n";
     string text = read_file_to_string("search.txt");
@@ -839,16 +4977,33 @@ int main() {
         test_boost_regex_search(text, name, pattern);
         test_pcre_search(text, name, pattern);
         test_re2_search(text, name, pattern);
+        verify_match_counts("search", name);
+    }
+
+    cout << "\n\n=== Testing GLOBAL ITERATION CONSISTENCY ===\n";
+    print_results_header();
+
+    for (const auto& [name, pattern] : iteration_check_patterns) {
+        cout << "\nTesting pattern: " << name << " (" << pattern << ")\n";
+
+        test_std_regex_search(text, name, pattern);
+        test_boost_regex_search(text, name, pattern);
+        test_pcre_search(text, name, pattern);
+        test_re2_search(text, name, pattern);
+        verify_match_counts("search", name);
     }
 
     cout << "\n\n=== Testing RUSSIAN TEXT SEARCH ===\n";
     string russian_text = read_file_to_string("search_russian.txt");
     if (russian_text.empty()) {
         cerr << "Failed to read search_russian.txt" << endl;
-        return;
+        return 1;
     }
 
     cout << "Loaded Russian War and Peace text (" << russian_text.size() << " characters)\n";
+    if (!contains_utf8_cyrillic(russian_text)) {
+        cout << "Warning: search_russian.txt contains no UTF-8 Cyrillic text, Cyrillic patterns will find nothing\n";
+    }
     print_results_header();
 
     for (const auto& [name, pattern] : war_and_peace_russian_patterns) {
@@ -858,22 +5013,28 @@ int main() {
         test_boost_regex_search(russian_text, name, pattern);
         test_pcre_search(russian_text, name, pattern);
         test_re2_search(russian_text, name, pattern);
+        verify_match_counts("search", name);
     }
 
+    cout << "\n\n=== Testing CAPTURE EXTRACTION COST ===\n";
+    cout << "English text:\n";
+    run_capture_matrix(text, war_and_peace_patterns);
+    cout << "\nRussian text:\n";
+    run_capture_matrix(russian_text, war_and_peace_russian_patterns);
+
+    cout << "\n\n=== Testing REPLACE AND TOKENIZE ===\n";
+    cout << "English text:\n";
+    run_rewrite_workloads(text, redaction_patterns, "Word frequencies");
+    cout << "\nRussian text:\n";
+    run_rewrite_workloads(russian_text, redaction_russian_patterns, "Частоты слов");
+
      cout << "\n\n=== Testing FILE EXTENSIONS EXTRACTION ===\n";
-    ifstream paths_file("file_formats_tests.txt");
-    if (!paths_file) {
+    vector<string> paths = read_dataset_lines("file_formats_tests.txt");
+    if (paths.empty()) {
         cerr << "Cannot open file_formats_tests.txt\n";
         return 1;
     }
 
-    vector<string> paths;
-    string path;
-    while (getline(paths_file, path)) {
-        paths.push_back(path);
-    }
-    paths_file.close();
-
     cout << "\nLoaded " << paths.size() << " paths for extensions extraction testing\n";
     cout << "Warming up cache... ";
     warmup_cache(paths);
@@ -886,19 +5047,12 @@ int main() {
     test_re2_extensions(paths);
 
         cout << "\n\n=== Testing FILE SEARCH BY NAME ===\n";
-    ifstream search_paths_file("files_search_tests.txt");
-    if (!search_paths_file) {
+    vector<string> search_paths = read_dataset_lines("files_search_tests.txt");
+    if (search_paths.empty()) {
         cerr << "Cannot open files_search_tests.txt\n";
         return 1;
     }
 
-    vector<string> search_paths;
-    string search_path;
-    while (getline(search_paths_file, search_path)) {
-        search_paths.push_back(search_path);
-    }
-    search_paths_file.close();
-
     cout << "\nLoaded " << search_paths.size() << " paths for file search testing\n";
     cout << "Warming up cache... ";
     warmup_cache(search_paths);